@@ -0,0 +1,374 @@
+// Micro-benchmarks for the hot paths of osc_dim_server.
+//
+// Runs without a DIM DNS and without the Python backend: services and commands are only
+// declared locally (DimServer::start is never called) and data is fed in directly.
+//
+// The pipeline/ benchmarks drive the full ZMQ SUB -> dispatch -> sink path over loopback TCP
+// into counting sinks, so they measure the receive loop rather than DIM.
+//
+// Usage: osc_dim_bench [--filter <substring>] [--min-time <ms>] [--frames <n>] [--list]
+
+#include "CommandHandlers.h"
+#include "ZMQCommunicator.h"
+#include "DimServices.h"
+#include "OutputSink.h"
+#include "Waveform.h"
+#include "Log.h"
+#include "Trace.h"
+#include "Constants.h"
+
+// Standard CPP libraries
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Outside dependencies
+#include <zmq.hpp>
+
+using json = nlohmann::json;
+
+// Allocation counting
+// ==========================================================
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Harness
+// ==========================================================
+namespace {
+
+struct BenchOptions {
+    std::string filter;
+    std::chrono::milliseconds min_time{500};
+    int pipeline_frames = 200;
+};
+
+struct Benchmark {
+    std::string name;
+    size_t bytes_per_op;
+    std::function<void()> op;
+};
+
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void run_benchmark(const Benchmark& bench, const BenchOptions& options) {
+    using clock = std::chrono::steady_clock;
+
+    bench.op(); // Warm up caches and let buffers reach their steady-state capacity.
+
+    uint64_t iterations = 1;
+    while (true) {
+        uint64_t allocs_before = g_allocations.load(std::memory_order_relaxed);
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) bench.op();
+        auto elapsed = clock::now() - start;
+        uint64_t allocs = g_allocations.load(std::memory_order_relaxed) - allocs_before;
+
+        if (elapsed >= options.min_time || iterations >= (1ull << 30)) {
+            double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+            double ns_per_op = ns / iterations;
+            double bytes_per_sec = bench.bytes_per_op * 1e9 / ns_per_op;
+            std::cout << std::left << std::setw(44) << bench.name << std::right
+                      << std::setw(14) << std::fixed << std::setprecision(1) << ns_per_op << " ns/op"
+                      << std::setw(12) << std::setprecision(1) << bytes_per_sec / 1e6 << " MB/s"
+                      << std::setw(10) << std::setprecision(2) << static_cast<double>(allocs) / iterations << " allocs/op"
+                      << std::setw(12) << iterations << " iters" << std::endl;
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+// Pipeline
+// ==========================================================
+// Loopback endpoints, away from the production ports so a running server does not interfere.
+constexpr const char* PIPELINE_ROUTER_ENDPOINT = "tcp://127.0.0.1:15555";
+constexpr const char* PIPELINE_PUB_ENDPOINT = "tcp://127.0.0.1:15558";
+
+// Publishes 'frames' acquisitions of 'channels' waveforms and waits until the sinks have seen them all.
+void run_pipeline(const std::string& name, const std::vector<std::string>& topics,
+                  const std::vector<std::string>& payloads, int channels, const BenchOptions& options) {
+    using clock = std::chrono::steady_clock;
+
+    CountingSinkFactory sinks;
+    CountingSink reply("BENCH/REPLY", 2048);
+    ZmqCommunicator comm(reply, sinks);
+
+    zmq::context_t context(1);
+    zmq::socket_t pub(context, zmq::socket_type::pub);
+    pub.set(zmq::sockopt::sndhwm, 0); // Never drop on the sending side; losses are the server's.
+    pub.bind(PIPELINE_PUB_ENDPOINT);
+    comm.start(PIPELINE_ROUTER_ENDPOINT, PIPELINE_PUB_ENDPOINT);
+
+    // Slow joiner: repeat a state message until the subscription is live.
+    CountingSink* state = sinks.find(Constants::STATE_SERVICE);
+    while (state->updates() == 0) {
+        pub.send(zmq::buffer(std::string(Constants::ZMQ_STATE_TOPIC)), zmq::send_flags::sndmore);
+        pub.send(zmq::buffer(std::string("IDLE")), zmq::send_flags::none);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    const uint64_t expected = static_cast<uint64_t>(options.pipeline_frames) * channels;
+    const uint64_t base = sinks.total_updates();
+    size_t frame_bytes = 0;
+    for (int ch = 0; ch < channels; ++ch) frame_bytes += payloads[ch].size();
+
+    uint64_t allocs_before = g_allocations.load(std::memory_order_relaxed);
+    auto start = clock::now();
+    for (int frame = 0; frame < options.pipeline_frames; ++frame) {
+        for (int ch = 0; ch < channels; ++ch) {
+            pub.send(zmq::buffer(topics[ch]), zmq::send_flags::sndmore);
+            pub.send(zmq::buffer(payloads[ch]), zmq::send_flags::none);
+        }
+    }
+
+    // Wait for the sinks to drain, giving up once nothing has arrived for a second.
+    uint64_t received = 0;
+    auto last_progress = clock::now();
+    while (received < expected && clock::now() - last_progress < std::chrono::seconds(1)) {
+        uint64_t now_received = sinks.total_updates() - base;
+        if (now_received != received) {
+            received = now_received;
+            last_progress = clock::now();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    auto elapsed = (received < expected ? last_progress : clock::now()) - start;
+    uint64_t allocs = g_allocations.load(std::memory_order_relaxed) - allocs_before;
+    comm.stop();
+
+    double ns_per_frame = std::chrono::duration<double, std::nano>(elapsed).count() / options.pipeline_frames;
+    std::cout << std::left << std::setw(44) << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1) << ns_per_frame << " ns/op"
+              << std::setw(12) << std::setprecision(1) << frame_bytes * 1e3 / ns_per_frame << " MB/s"
+              << std::setw(10) << std::setprecision(2) << static_cast<double>(allocs) / options.pipeline_frames << " allocs/op"
+              << std::setw(12) << options.pipeline_frames << " iters"
+              << "  (" << expected - received << " updates lost)" << std::endl;
+}
+
+// Test data
+// ==========================================================
+const size_t SAMPLE_COUNTS[] = {10000, 100000, 1000000};
+const int MAX_CHANNELS = Constants::OSC_NUM_CHANNELS;
+
+// Deterministic sine plus noise, roughly what a PMT channel looks like on screen.
+std::vector<double> make_samples(size_t count, int channel) {
+    std::mt19937 rng(1234 + channel);
+    std::normal_distribution<double> noise(0.0, 2e-3);
+    std::vector<double> samples(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = 0.05 * std::sin(2.0 * M_PI * i / 1000.0 + channel) + noise(rng);
+    }
+    return samples;
+}
+
+std::string size_label(size_t samples) {
+    if (samples >= 1000000) return std::to_string(samples / 1000000) + "M";
+    return std::to_string(samples / 1000) + "k";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    bool list_only = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) options.filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc) options.min_time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        else if (arg == "--frames" && i + 1 < argc) options.pipeline_frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--list") list_only = true;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <ms>] [--frames <n>] [--list]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Keep the server's log lines out of the report.
+    FILE* devnull = fopen("/dev/null", "w");
+    if (devnull) Log::set_output(devnull, devnull);
+
+    // Objects under test. Nothing here talks to a DNS: DimServer::start is never called.
+    ReplyService reply_service;
+    DimSinkFactory dim_sinks;
+    ZmqCommunicator zmq_comm(reply_service, dim_sinks);
+
+    // Same dispatch, minus the DIM copy, to isolate the routing cost.
+    NullSink null_reply;
+    NullSinkFactory null_sinks;
+    ZmqCommunicator null_comm(null_reply, null_sinks);
+
+    FlexibleJsonCommand scale_cmd(zmq_comm, "BENCH/CHANNEL/SET_SCALE", "I:1;F:1", Constants::PY_SET_CHAN_SCALE,
+        [](DimCommand*, json& params) {
+            params[Constants::JSON_CHANNEL] = 2;
+            params["scale"] = 5.0e-3f;
+        }
+    );
+    FlexibleJsonCommand mode_cmd(zmq_comm, "BENCH/ACQUISITION/SET_MODE", "C", Constants::PY_SET_ACQ_MODE,
+        [](DimCommand*, json& params) {
+            params["state"] = "CONT";
+        }
+    );
+
+    // Preformatted payloads per size and channel.
+    std::vector<std::vector<std::vector<double>>> samples;
+    std::vector<std::vector<std::string>> payloads;
+    for (size_t count : SAMPLE_COUNTS) {
+        samples.emplace_back();
+        payloads.emplace_back();
+        for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+            samples.back().push_back(make_samples(count, ch));
+            payloads.back().emplace_back();
+            Waveform::format(samples.back().back().data(), count, payloads.back().back());
+        }
+    }
+
+    std::vector<std::unique_ptr<OutputSink>> bench_svcs;
+    std::vector<Benchmark> benchmarks;
+
+    // FlexibleJsonCommand::commandHandler without the ZMQ send
+    benchmarks.push_back({"command/build_request/set_scale", scale_cmd.build_request().size(),
+        [&] { do_not_optimize(scale_cmd.build_request()); }});
+    benchmarks.push_back({"command/build_request/set_mode", mode_cmd.build_request().size(),
+        [&] { do_not_optimize(mode_cmd.build_request()); }});
+
+    // Cost on the calling thread only; the flusher formats and writes in the background.
+    // In a tight loop the ring fills up, so log/write mixes stores with the drop path.
+    std::string log_command = scale_cmd.build_request();
+    benchmarks.push_back({"log/debug_disabled", log_command.size(),
+        [&] { LOG_DEBUG("Sending command to Python: {}", log_command); }});
+    benchmarks.push_back({"log/write", log_command.size(),
+        [&] { Log::write(Log::LEVEL_INFO, "Sending command to Python: {}", log_command); }});
+
+    // Instrumentation left in the hot paths while tracing is off
+    benchmarks.push_back({"trace/scope_disabled", 0,
+        [&] { OSC_TRACE_SCOPE("bench"); }});
+
+    // State topics through the subscriber dispatch
+    Frame state_frame{Constants::ZMQ_STATE_TOPIC, "IDLE", "", 0};
+    benchmarks.push_back({"dispatch/backend_state", state_frame.payload.size(),
+        [&] { zmq_comm.dispatch(state_frame); }});
+
+    std::vector<std::string> waveform_topics;
+    for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+        waveform_topics.push_back(Constants::ZMQ_WAVEFORM_TOPIC_BASE + std::to_string(ch + 1));
+    }
+
+    // Received frames per size and channel, with and without a trace header.
+    std::vector<std::vector<Frame>> frames(std::size(SAMPLE_COUNTS));
+    std::vector<std::vector<Frame>> traced_frames(std::size(SAMPLE_COUNTS));
+    const std::string trace_header = json{{Constants::JSON_TRACE, {
+        {"arm", 1000}, {"complete", 2000}, {"transfer_start", 2000}, {"transfer", 3000}, {"format", 4000}, {"publish", 5000}
+    }}}.dump();
+    for (size_t s = 0; s < std::size(SAMPLE_COUNTS); ++s) {
+        for (int ch = 0; ch < MAX_CHANNELS; ++ch) {
+            frames[s].push_back(Frame{waveform_topics[ch], payloads[s][ch], "", 0});
+            traced_frames[s].push_back(Frame{waveform_topics[ch], payloads[s][ch], trace_header, 6000});
+        }
+    }
+
+    std::string scratch;
+    std::vector<double> parsed;
+    for (size_t s = 0; s < std::size(SAMPLE_COUNTS); ++s) {
+        const size_t count = SAMPLE_COUNTS[s];
+        const std::string size = size_label(count);
+
+        // ProtectedDimService::update with a buffer large enough for the full record
+        bench_svcs.push_back(std::make_unique<ProtectedDimService>("BENCH/CH_" + size, payloads[s][0].size() + 1));
+        OutputSink* svc = bench_svcs.back().get();
+        benchmarks.push_back({"service/update/" + size, payloads[s][0].size(),
+            [&payloads, svc, s] { svc->update(payloads[s][0]); }});
+
+        bench_svcs.push_back(std::make_unique<CountingSink>("BENCH/COUNTING_" + size, payloads[s][0].size() + 1));
+        OutputSink* counting = bench_svcs.back().get();
+        benchmarks.push_back({"service/counting_sink/" + size, payloads[s][0].size(),
+            [&payloads, counting, s] { counting->update(payloads[s][0]); }});
+
+        for (int channels = 1; channels <= MAX_CHANNELS; ++channels) {
+            const std::string suffix = size + "/" + std::to_string(channels) + "ch";
+            size_t text_bytes = 0;
+            for (int ch = 0; ch < channels; ++ch) text_bytes += payloads[s][ch].size();
+
+            // Full subscribe_loop dispatch into the SCOPE/ACQUISITION/CH<x> services.
+            // Payloads above WAVEFORM_BUFFER_SIZE are truncated exactly as in production.
+            benchmarks.push_back({"dispatch/waveform/" + suffix, text_bytes,
+                [&zmq_comm, &frames, s, channels] {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        zmq_comm.dispatch(frames[s][ch]);
+                    }
+                }});
+
+            benchmarks.push_back({"dispatch/null_sink/" + suffix, text_bytes,
+                [&null_comm, &frames, s, channels] {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        null_comm.dispatch(frames[s][ch]);
+                    }
+                }});
+
+            benchmarks.push_back({"dispatch/null_sink_traced/" + suffix, text_bytes,
+                [&null_comm, &traced_frames, s, channels] {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        null_comm.dispatch(traced_frames[s][ch]);
+                    }
+                }});
+
+            benchmarks.push_back({"waveform/format/" + suffix, text_bytes,
+                [&samples, &scratch, s, channels, count] {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        Waveform::format(samples[s][ch].data(), count, scratch);
+                        do_not_optimize(scratch.data());
+                    }
+                }});
+
+            benchmarks.push_back({"waveform/parse/" + suffix, text_bytes,
+                [&payloads, &parsed, s, channels] {
+                    for (int ch = 0; ch < channels; ++ch) {
+                        Waveform::parse(payloads[s][ch], parsed);
+                        do_not_optimize(parsed.data());
+                    }
+                }});
+        }
+    }
+
+    for (const auto& bench : benchmarks) {
+        if (!options.filter.empty() && bench.name.find(options.filter) == std::string::npos) continue;
+        if (list_only) {
+            std::cout << bench.name << std::endl;
+            continue;
+        }
+        run_benchmark(bench, options);
+    }
+
+    // The pipeline runs at the production record length (10k samples) only.
+    for (int channels = 1; channels <= MAX_CHANNELS; ++channels) {
+        const std::string name = "pipeline/zmq_to_sink/10k/" + std::to_string(channels) + "ch";
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) continue;
+        if (list_only) {
+            std::cout << name << std::endl;
+            continue;
+        }
+        run_pipeline(name, waveform_topics, payloads[0], channels, options);
+    }
+    return 0;
+}
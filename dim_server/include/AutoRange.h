@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "Constants.h"
+
+// Per-channel vertical auto-ranging from the published waveforms. While a channel is SEEKING, every
+// frame is checked for samples on the ADC rails (clipping) and for its peak in divisions; the scale
+// is moved along the scope's 1-2-5 ladder until the peak sits inside the hysteresis band, then the
+// channel LOCKs and costs nothing until it is enabled again.
+//
+// Frames still acquired at the old scale after a change was requested are skipped: they are neither
+// evaluated nor published.
+class AutoRange {
+public:
+    enum State { OFF, SEEKING, LOCKED, FAILED };
+
+    struct Decision {
+        bool publish = true;
+        double new_scale = 0.0;     // > 0: send SET_SCALE with this volts/div
+    };
+
+    static constexpr double RAIL_DIVS = 5.0;        // Full scale is +-5.08 div (+-127 levels at 25 levels/div)
+    static constexpr double LOW_DIVS = 1.0;         // Hysteresis band of the peak, in divisions
+    static constexpr double HIGH_DIVS = 4.5;
+    static constexpr double TARGET_DIVS = 3.5;      // Where a new scale puts the peak
+    static constexpr double CLIP_FACTOR = 2.5;      // Minimum step up when clipped (the true peak is unknown)
+    static constexpr size_t MIN_RAIL_HITS = 3;      // Fewer hits on the rails are treated as noise
+    static constexpr int MAX_CHANGES = 8;           // Gives up (FAILED) after this many changes
+    static constexpr double MIN_SCALE = 1e-3;       // TDS3054C: 1 mV/div ..
+    static constexpr double MAX_SCALE = 10.0;       // .. 10 V/div
+
+    void set_enabled(int channel, bool enabled);
+
+    // Cheap check, so the caller only parses the samples of channels being ranged.
+    bool seeking(int channel) const;
+
+    // 'scale' is the volts/div the frame was acquired with (from its header).
+    Decision evaluate(int channel, const std::vector<double>& samples, double scale);
+
+    // Per channel: state, scale, peak_divs, rail_hits, changes, skipped.
+    nlohmann::json status() const;
+
+    // Smallest 1-2-5 ladder value >= volts_per_div, clamped to [MIN_SCALE, MAX_SCALE].
+    static double ladder_at_least(double volts_per_div);
+
+private:
+    struct Channel {
+        State state = OFF;
+        double scale = 0.0;             // Of the last evaluated frame
+        double pending_scale = 0.0;     // Requested, not yet seen in a frame header
+        double peak_divs = 0.0;
+        size_t rail_hits = 0;
+        int changes = 0;
+        uint64_t skipped = 0;
+    };
+
+    mutable std::mutex mtx;
+    std::array<Channel, Constants::OSC_NUM_CHANNELS> channels;
+};
@@ -7,7 +7,8 @@
 
 class ZmqCommunicator; // Forward declaration
 
-// A highly flexible command handler that uses a lambda to populate parameters.
+// A highly flexible command handler that uses a lambda to populate parameters. Input the lambda
+// rejects is answered with an error on SCOPE/REPLY instead of being forwarded.
 class FlexibleJsonCommand : public DimCommand {
     using json = nlohmann::json;
     // A function that takes a pointer to the command itself and a reference to the JSON object to be filled.
@@ -23,6 +24,10 @@ public:
                         std::string py_cmd, ParamPopulator param_populator);
 
     void commandHandler() override;
+
+    // Builds the JSON request forwarded to Python (separate from the send so it can be benchmarked).
+    // A populator throws std::invalid_argument for input it rejects; nothing is sent then.
+    std::string build_request();
 };
 
 // We still need the struct for multi-parameter commands.
@@ -31,6 +36,12 @@ struct ChannelCommandData {
     float value;
 };
 
+// SCOPE/ACQUISITION/SET_WINDOW: first and last sample (1-based) of the transferred window.
+struct WindowCommandData {
+    int start;
+    int stop;
+};
+
 // RawCommandService is specialized and remains as is.
 class RawCommandService : public DimCommand {
     ZmqCommunicator& zmq_comm;
@@ -38,4 +49,21 @@ class RawCommandService : public DimCommand {
 public:
     RawCommandService(ZmqCommunicator& comm);
     void commandHandler() override;
+};
+
+// SCOPE/CHANNEL/SET_AUTO_RANGE: "<channel>;<1|0>". Ranging runs in the server, which sends the
+// resulting SET_SCALE commands itself.
+class AutoRangeCommand : public DimCommand {
+    ZmqCommunicator& zmq_comm;
+public:
+    AutoRangeCommand(ZmqCommunicator& comm);
+    void commandHandler() override;
+};
+
+// SCOPE/DEBUG/TRACE: "ON", "OFF", or "DUMP" to write the trace buffers as Chrome trace JSON.
+// Handled in the server; nothing is forwarded to Python.
+class TraceCommand : public DimCommand {
+public:
+    TraceCommand();
+    void commandHandler() override;
 };
\ No newline at end of file
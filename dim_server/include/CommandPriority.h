@@ -0,0 +1,15 @@
+#pragma once
+#include <nlohmann/json.hpp>
+
+// How a message is ordered on its way to the backend. Commands keep the order they were sent in,
+// with one exception: a stop overtakes the configuration traffic queued before it, but never a mode
+// command, so CONT followed by OFF still ends stopped. Control messages go before any command. The
+// backend orders what it has received the same way (see CommandQueue in the backend).
+enum class CommandPriority {
+    CONTROL,    // Demand, credit, promotion: small, and keep the backend current
+    ABORT,      // set_acquisition_mode OFF
+    MODE,       // Any other set_acquisition_mode, run_sequence
+    NORMAL      // Settings, setups, raw queries and writes
+};
+
+CommandPriority command_priority(const nlohmann::json& request);
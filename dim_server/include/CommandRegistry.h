@@ -2,5 +2,8 @@
 
 class ZmqCommunicator; // Forward declaration
 
-// Creates and registers all DIM commands for the server.
-void register_all_commands(ZmqCommunicator& comm);
\ No newline at end of file
+// Creates and registers all DIM commands of one instrument, routed to its communicator.
+void register_all_commands(ZmqCommunicator& comm);
+
+// Creates and registers the commands of the server process itself (SCOPE/DEBUG/TRACE), once.
+void register_server_commands();
\ No newline at end of file
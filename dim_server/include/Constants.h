@@ -1,3 +1,4 @@
+#pragma once
 #include <string>
 
 namespace Constants {
@@ -6,12 +7,21 @@ namespace Constants {
     constexpr const char* REPLY_SERVICE = "SCOPE/REPLY";
     constexpr const char* STATE_SERVICE = "SCOPE/STATE";
     constexpr const char* TIMEDIV_SERVICE = "SCOPE/TIME_INCREMENT";
+    constexpr const char* LATENCY_SERVICE = "SCOPE/LATENCY";
+    constexpr const char* METRICS_SERVICE = "SCOPE/METRICS";
+    constexpr const char* BACKEND_TIMING_SERVICE = "SCOPE/BACKEND_TIMING";
+    constexpr const char* SEQUENCE_PROGRESS_SERVICE = "SCOPE/SEQUENCE/PROGRESS";
+    constexpr const char* AUTO_RANGE_SERVICE = "SCOPE/CHANNEL/AUTO_RANGE";
+    constexpr const char* SETUP_SLOTS_SERVICE = "SCOPE/SETUP/SLOTS";
+    constexpr const char* SETTINGS_SERVICE = "SCOPE/SETTINGS";
     const std::string WAVEFORM_SERVICE_BASE = "SCOPE/ACQUISITION/CH";
+    const std::string WAVEFORM_META_SUFFIX = "/META";
 
     // COMMAND NAMES 
     constexpr const char* RAW_CMD = "SCOPE/RAW";
     constexpr const char* CHAN_SET_ENABLED_CMD = "SCOPE/CHANNEL/SET_ENABLED";
     constexpr const char* CHAN_SET_SCALE_CMD = "SCOPE/CHANNEL/SET_SCALE";
+    constexpr const char* CHAN_SET_AUTO_RANGE_CMD = "SCOPE/CHANNEL/SET_AUTO_RANGE";
     constexpr const char* TRIG_SET_CHANNEL_CMD = "SCOPE/TRIGGER/SET_CHANNEL";
     constexpr const char* TRIG_SET_SLOPE_CMD = "SCOPE/TRIGGER/SET_SLOPE";
     constexpr const char* TRIG_SET_LEVEL_CMD = "SCOPE/TRIGGER/SET_LEVEL";
@@ -19,13 +29,25 @@ namespace Constants {
     constexpr const char* ACQ_SET_TIMEOUT_CMD = "SCOPE/ACQUISITION/SET_TIMEOUT";
     constexpr const char* ACQ_SET_IGNORE_CMD = "SCOPE/ACQUISITION/IGNORE_TIMEOUT";
     constexpr const char* ACQ_SET_MODE_CMD = "SCOPE/ACQUISITION/SET_MODE";
+    constexpr const char* ACQ_SET_WINDOW_CMD = "SCOPE/ACQUISITION/SET_WINDOW";
+    constexpr const char* ACQ_SET_SAMPLING_CMD = "SCOPE/ACQUISITION/SET_SAMPLING";
+    constexpr const char* TRACE_CMD = "SCOPE/DEBUG/TRACE";
+    constexpr const char* SEQUENCE_RUN_CMD = "SCOPE/SEQUENCE/RUN";
+    constexpr const char* SETUP_SAVE_CMD = "SCOPE/SETUP/SAVE";
+    constexpr const char* SETUP_RECALL_CMD = "SCOPE/SETUP/RECALL";
 
     // ZMQ Endpoints and Topics
     constexpr const char* ZMQ_ROUTER_ENDPOINT = "tcp://*:5555";
     // This MUST match the 'dim_publish_endpoint' in the Python config
     constexpr const char* ZMQ_SUB_ENDPOINT = "tcp://localhost:5558"; 
+    // With several instruments (OSC_INSTRUMENTS), instrument <n> uses both ports + (n - 1) * this
+    const int INSTRUMENT_PORT_STRIDE = 10;
+    const int MAX_INSTRUMENTS = 16;
     constexpr const char* ZMQ_STATE_TOPIC = "backend_state";
     constexpr const char* ZMQ_TIMEDIV_TOPIC = "waveform_timediv";
+    constexpr const char* ZMQ_TIMING_TOPIC = "backend_timing";
+    constexpr const char* ZMQ_SEQUENCE_TOPIC = "sequence_progress";
+    constexpr const char* ZMQ_SETUP_SLOTS_TOPIC = "setup_slots";
     const std::string ZMQ_WAVEFORM_TOPIC_BASE = "waveform_ch";
 
     // JSON Keys
@@ -38,6 +60,14 @@ namespace Constants {
     constexpr const char* JSON_MESSAGE = "message";
     constexpr const char* JSON_QUERY = "query";
     constexpr const char* JSON_CHANNEL = "channel";
+    constexpr const char* JSON_TRACE = "trace";
+    constexpr const char* JSON_SEQUENCE = "sequence";
+    constexpr const char* JSON_CHANNELS = "channels";
+    constexpr const char* JSON_SCALE = "scale";
+    constexpr const char* JSON_INSTRUMENT = "instrument";
+    constexpr const char* JSON_BACKEND = "backend";
+    constexpr const char* JSON_ROLE = "role";
+    constexpr const char* JSON_PUBLISH_ENDPOINT = "publish_endpoint";
 
     // Python Command Names ---
     constexpr const char* PY_SET_CHAN_ENABLED = "set_channel_enabled";
@@ -49,11 +79,44 @@ namespace Constants {
     constexpr const char* PY_SET_ACQ_TIMEDIV = "set_acquisition_timediv";
     constexpr const char* PY_SET_ACQ_TIMEOUT = "set_acquisition_timeout";
     constexpr const char* PY_SET_ACQ_IGNORE = "set_acquisition_ignore";
+    constexpr const char* PY_SET_ACQ_WINDOW = "set_acquisition_window";
+    constexpr const char* PY_SET_ACQ_SAMPLING = "set_acquisition_sampling";
+    constexpr const char* PY_RUN_SEQUENCE = "run_sequence";
+    constexpr const char* PY_SAVE_SETUP = "save_setup";
+    constexpr const char* PY_RECALL_SETUP = "recall_setup";
     constexpr const char* PY_RAW_QUERY = "raw_query";
     constexpr const char* PY_RAW_WRITE = "raw_write";
 
+    // Control messages: sent with "type": "control", never answered
+    constexpr const char* PY_SET_WANTED_CHANNELS = "set_wanted_channels";
+    constexpr const char* PY_GRANT_CREDIT = "grant_credit";
+    constexpr const char* PY_HEARTBEAT = "heartbeat";   // To the backend's heartbeat DEALER, echoed while healthy
+    constexpr const char* PY_PROMOTE = "promote";       // Standby backend: you are the active one now
+
     // App specific
-    const int OSC_NUM_CHANNELS = 4;   
+    constexpr int OSC_NUM_CHANNELS = 4;
     const int WAVEFORM_BUFFER_SIZE = 130000; 
     const int STATE_BUFFER_SIZE = 256; 
+    const int META_BUFFER_SIZE = 1024;
+    const int AUTO_RANGE_BUFFER_SIZE = 1024;
+    const int SETUP_SLOTS_BUFFER_SIZE = 4096;
+    const int SETTINGS_BUFFER_SIZE = 2048;
+    const int LATENCY_BUFFER_SIZE = 4096;
+    const int METRICS_BUFFER_SIZE = 16384;
+    const int BACKEND_TIMING_BUFFER_SIZE = 4096;
+    const int BACKEND_TIMING_WINDOW_S = 10;     // Rolling window of the live-time fraction
+    const int STATS_PUBLISH_PERIOD_MS = 1000;   // SCOPE/LATENCY and SCOPE/METRICS
+    const int REPLY_EXPIRY_MS = 60000;          // Commands unanswered for this long count as reply_expired
+    const int ROUTER_POLL_MS = 10;              // ROUTER thread wake-up period for the heartbeats (queued messages wake it at once)
+    const int MAX_OUTGOING_MESSAGES = 256;      // Commands and control messages waiting for the ROUTER thread
+    const int CREDIT_WINDOW = 16;               // Waveform frames the backend may have in flight to the server
+    const int ZMQ_SUB_HWM = 64;                 // Messages queued on the SUB socket; above the credit window
+    const int SUB_POLL_MS = 100;                // Only bounds how long stop() waits for the subscribe thread
+    const int CHANNEL_QUEUE_FRAMES = 16;        // Per channel publisher; holds the whole credit window
+    const int OTHER_QUEUE_FRAMES = 64;          // State, timing and the other small topics
+    const int HEARTBEAT_INTERVAL_MS = 100;      // Heartbeats to every backend with a heartbeat DEALER
+    const int HEARTBEAT_TIMEOUT_MS = 500;       // No echo for this long: the backend is lost
+    // Default of OSC_ANALYSIS_THREADS. 0 runs the analysis inline on the publishers: the tasks of a
+    // frame form a serial chain today, so pool workers would only add a handoff per frame.
+    const int ANALYSIS_THREADS = 0;
 }
\ No newline at end of file
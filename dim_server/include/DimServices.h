@@ -4,17 +4,21 @@
 #include <mutex>
 #include <dis.hxx>
 
-class ReplyService {
+#include "OutputSink.h"
+
+class ReplyService : public OutputSink {
     char buffer[2048];
     DimService reply_service;
     std::mutex mtx;
 
 public:
     ReplyService();
-    void update(const std::string& new_reply);
+    // SCOPE<n>/REPLY of one of several instruments
+    explicit ReplyService(const std::string& name);
+    void update(const std::string& new_reply) override;
 };
 
-class ProtectedDimService {
+class ProtectedDimService : public OutputSink {
 public:
     // Constructor takes the DIM service name and the size for its internal buffer.
     ProtectedDimService(const std::string& name, size_t buffer_size);
@@ -22,10 +26,22 @@ public:
     ProtectedDimService(const ProtectedDimService&) = delete;
     ProtectedDimService& operator=(const ProtectedDimService&) = delete;
 
-    void update(const std::string& new_data);
+    // Every update carries its publish time as the DIM timestamp, so stamped subscribers can measure
+    // delivery latency.
+    void update(const std::string& new_data) override;
+
+    int subscribers() override { return service.getNClients(); }
 
 private:
     std::mutex mtx;
     std::vector<char> buffer;
     DimService service;
-};
\ No newline at end of file
+};
+
+// Publishes every sink as a DIM service.
+class DimSinkFactory : public SinkFactory {
+public:
+    std::unique_ptr<OutputSink> create(const std::string& name, size_t buffer_size) override {
+        return std::make_unique<ProtectedDimService>(name, buffer_size);
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <nlohmann/json.hpp>
+
+// Rolling acquisition duty cycle from the backend_timing messages of BackendWorker: where the wall
+// time of the last window went, per phase, and the live-time fraction (time the scope was armed and
+// waiting for a trigger, i.e. able to record an event).
+class DutyCycle {
+public:
+    enum Phase {
+        CONFIGURE,          // Single-sequence setup before arming
+        ARM,                // ACQ:STATE ON
+        WAIT_FOR_TRIGGER,   // BUSY? polling until the acquisition completes (live time)
+        TRANSFER,           // CURVE? of all channels
+        FORMAT,
+        PUBLISH,
+        TIMEDIV,            // WFMPre:XINcr? after the transfers
+        OTHER,              // Between cycles and everything not covered above (dead time)
+        PHASE_COUNT
+    };
+
+    explicit DutyCycle(int64_t window_ns) : window_ns(window_ns) {}
+
+    // Adds one backend_timing message. Returns false if it lacks the cycle start/end stamps.
+    bool add(const nlohmann::json& timing);
+
+    // window_s, cycles, cycle_rate_hz, live_fraction, timeouts, aborted, per-phase fraction and mean_ms, and the
+    // last message as received.
+    nlohmann::json summary() const;
+
+private:
+    struct Cycle {
+        int64_t end_ns;
+        int64_t wall_ns;    // From the end of the previous cycle (or this cycle's start) to this end
+        bool timeout;
+        bool aborted;       // Cut short by a stop command
+        std::array<int64_t, PHASE_COUNT> phases;
+    };
+
+    const int64_t window_ns;
+    std::deque<Cycle> cycles;
+    nlohmann::json last;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "SpscQueue.h"
+
+// One message from the SUB socket: [topic, payload] and an optional JSON header part.
+struct Frame {
+    std::string topic;
+    std::string payload;
+    std::string header;
+    int64_t received_ns = 0;   // monotonic_ns() when subscribe_loop took it off the socket
+};
+
+// A worker thread fed by one producer (the subscribe thread) through a bounded SPSC queue. The
+// producer only decodes and hands frames over; DIM updates and any analysis run here, so a slow
+// service update on one channel no longer holds up the socket or the other channels.
+//
+// The worker sleeps on a condition variable while idle. The producer takes the lock only to wake
+// a sleeping worker, never on the per-frame path of a busy one.
+class FramePublisher {
+public:
+    using Handler = std::function<void(Frame&)>;
+
+    FramePublisher(std::string thread_name, size_t capacity, Handler handler);
+    ~FramePublisher();
+
+    FramePublisher(const FramePublisher&) = delete;
+    FramePublisher& operator=(const FramePublisher&) = delete;
+
+    void start();
+    // Handles what is still queued, then joins the worker.
+    void stop();
+
+    // Producer only. False (the frame is left with the caller) when the queue is full.
+    bool offer(Frame& frame);
+
+    size_t queued() const { return queue.size(); }
+    uint64_t handled() const { return handled_count.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    std::string name;
+    SpscQueue<Frame> queue;
+    Handler handler;
+
+    std::mutex mtx;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> handled_count{0};
+    std::thread worker;
+};
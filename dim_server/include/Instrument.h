@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+// One oscilloscope backend served by this process. Every instrument has its own ZmqCommunicator:
+// its own ports, services, buffers and threads.
+//
+// A single instrument keeps the plain SCOPE/ names and the default ports. With several, instrument
+// <n> publishes under SCOPE<n>/ and its backend uses the default ports moved by (n - 1) strides.
+struct Instrument {
+    int number = 1;                 // Also expected in the backend's handshake
+    std::string prefix;             // Replaces the leading "SCOPE" of every service and command name
+    std::string router_endpoint;
+    std::string sub_endpoint;
+
+    // "SCOPE/ACQUISITION/CH" -> "<prefix>/ACQUISITION/CH"
+    std::string service(const std::string& name) const;
+
+    // Instrument 'number' (1-based) of 'count'.
+    static Instrument numbered(int number, int count);
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Nanoseconds on CLOCK_MONOTONIC, the same clock as Python's time.monotonic() on Linux,
+// so stamps taken by the backend and by the server on one host can be subtracted.
+inline int64_t monotonic_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// HDR-style log-linear histogram of durations in nanoseconds: 16 linear sub-buckets per power of two
+// (~6% resolution) up to 2^40 ns. Fixed memory, lock-free record().
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void record(int64_t ns);
+    void reset();
+
+    // count, mean and p50/p90/p99/max in microseconds.
+    nlohmann::json summary() const;
+
+private:
+    static int bucket_index(uint64_t ns);
+    static uint64_t bucket_lower_bound(int index);
+    uint64_t percentile(const std::array<uint64_t, BUCKET_COUNT>& counts, uint64_t total, double fraction) const;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> total_count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+};
+
+// Per-stage latency of waveform frames, from the trace header stamped along the way:
+//   backend: arm -> complete -> transfer_start -> transfer -> format -> publish
+//   server:  receive -> decode -> published
+class LatencyTracer {
+public:
+    enum Stage {
+        WAIT_FOR_TRIGGER,   // arm -> complete (includes BUSY? polling)
+        CURVE_TRANSFER,     // transfer_start -> transfer
+        PYTHON_FORMAT,      // transfer -> format
+        PYTHON_PUBLISH,     // format -> publish
+        ZMQ_HOP,            // publish -> receive (includes the wait for subscribe_loop)
+        SERVER_DECODE,      // receive -> decode
+        DIM_PUBLISH,        // decode -> published
+        END_TO_END,         // arm -> published
+        STAGE_COUNT
+    };
+
+    // 'trace' is the "trace" object of a frame header; missing stamps skip their stages.
+    void record(const nlohmann::json& trace, int64_t received_ns, int64_t decoded_ns, int64_t published_ns);
+
+    nlohmann::json summary() const;
+
+private:
+    std::array<LatencyHistogram, STAGE_COUNT> stages;
+};
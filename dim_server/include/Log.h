@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Asynchronous logger for the server threads.
+//
+//   LOG_INFO("Sending command to Python: {}", json_str);
+//
+// The calling thread only copies the format pointer and the arguments into a fixed-size record of its
+// own lock-free ring (tens of nanoseconds); a background thread formats the records, merges the rings
+// in timestamp order and writes them out. A full ring drops the record instead of blocking, and each
+// call site is rate limited, so a slow terminal or a flood of errors never stalls a hot path.
+//
+// The format must be a string literal; each "{}" is replaced by the next argument (integers, floating
+// point, bool, C strings, std::string). Strings are copied and truncated to fit the record.
+namespace Log {
+    // Prefixed: DIM and some build flags define DEBUG/INFO/ERROR as macros.
+    enum Level : uint8_t { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARN, LEVEL_ERROR, LEVEL_OFF };
+
+    void set_level(Level level);
+    // "debug", "info", "warn", "error" or "off"; anything else gives LEVEL_INFO.
+    Level parse_level(const std::string& name);
+
+    // Destinations of the flusher thread (default stdout, and stderr from LEVEL_WARN up).
+    void set_output(FILE* out, FILE* err);
+
+    // Blocks until everything logged before the call has been written.
+    void flush();
+
+    // Records lost to full rings since start.
+    uint64_t dropped();
+
+    namespace detail {
+        extern std::atomic<uint8_t> current_level;
+
+        constexpr size_t RECORD_SIZE = 256;
+
+        struct Record {
+            int64_t wall_ns;
+            const char* format;
+            Level level;
+            uint8_t arg_count;
+            uint16_t used;
+            char args[RECORD_SIZE - sizeof(int64_t) - sizeof(const char*) - sizeof(uint32_t)];
+        };
+        static_assert(sizeof(Record) == RECORD_SIZE, "Log record must fill its slot exactly");
+
+        enum ArgType : uint8_t { ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_BOOL, ARG_STRING };
+
+        // Slot of the calling thread's ring, or nullptr when the ring is full.
+        Record* claim();
+        void publish();
+
+        inline bool put_raw(Record& r, ArgType type, const void* data, size_t size) {
+            if (r.used + 1 + size > sizeof(r.args)) return false;
+            r.args[r.used++] = static_cast<char>(type);
+            std::memcpy(r.args + r.used, data, size);
+            r.used += static_cast<uint16_t>(size);
+            ++r.arg_count;
+            return true;
+        }
+
+        inline void put_string(Record& r, const char* s, size_t length) {
+            if (r.used + 1 + sizeof(uint16_t) > sizeof(r.args)) return;
+            size_t room = sizeof(r.args) - r.used - 1 - sizeof(uint16_t);
+            uint16_t n = static_cast<uint16_t>(length < room ? length : room);
+            r.args[r.used++] = static_cast<char>(ARG_STRING);
+            std::memcpy(r.args + r.used, &n, sizeof(n));
+            std::memcpy(r.args + r.used + sizeof(n), s, n);
+            r.used += static_cast<uint16_t>(sizeof(n) + n);
+            ++r.arg_count;
+        }
+
+        inline void put(Record& r, bool value) { put_raw(r, ARG_BOOL, &value, sizeof(value)); }
+        inline void put(Record& r, double value) { put_raw(r, ARG_DOUBLE, &value, sizeof(value)); }
+        inline void put(Record& r, float value) { put(r, static_cast<double>(value)); }
+        inline void put(Record& r, const char* value) { put_string(r, value, std::strlen(value)); }
+        inline void put(Record& r, const std::string& value) { put_string(r, value.data(), value.size()); }
+
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+        void put(Record& r, T value) {
+            if (std::is_signed<T>::value) {
+                int64_t v = static_cast<int64_t>(value);
+                put_raw(r, ARG_INT, &v, sizeof(v));
+            } else {
+                uint64_t v = static_cast<uint64_t>(value);
+                put_raw(r, ARG_UINT, &v, sizeof(v));
+            }
+        }
+
+        inline void put_all(Record&) {}
+        template <typename T, typename... Rest>
+        void put_all(Record& r, const T& first, const Rest&... rest) {
+            put(r, first);
+            put_all(r, rest...);
+        }
+
+        int64_t wall_clock_ns();
+    }
+
+    inline bool enabled(Level level) {
+        return level >= detail::current_level.load(std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void write(Level level, const char* format, const Args&... args) {
+        detail::Record* r = detail::claim();
+        if (!r) return;
+        r->wall_ns = detail::wall_clock_ns();
+        r->format = format;
+        r->level = level;
+        r->arg_count = 0;
+        r->used = 0;
+        detail::put_all(*r, args...);
+        detail::publish();
+    }
+
+    // Lets through at most 'per_second' messages per second from one call site and counts the rest.
+    class RateLimit {
+    public:
+        explicit RateLimit(uint32_t per_second = 20) : limit(per_second) {}
+
+        // 'suppressed' receives the messages dropped in the previous window when a new one starts.
+        bool allow(uint64_t& suppressed);
+
+    private:
+        const uint32_t limit;
+        std::atomic<int64_t> window{-1};
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+}
+
+#define OSC_LOG(level, ...)                                                                              \
+    do {                                                                                                 \
+        if (::Log::enabled(level)) {                                                                     \
+            static ::Log::RateLimit osc_log_limit;                                                       \
+            uint64_t osc_log_suppressed = 0;                                                             \
+            bool osc_log_allowed = osc_log_limit.allow(osc_log_suppressed);                              \
+            if (osc_log_suppressed > 0)                                                                  \
+                ::Log::write(level, "{} messages suppressed at {}:{}", osc_log_suppressed, __FILE__, __LINE__); \
+            if (osc_log_allowed) ::Log::write(level, __VA_ARGS__);                                       \
+        }                                                                                                \
+    } while (0)
+
+#define LOG_DEBUG(...) OSC_LOG(::Log::LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) OSC_LOG(::Log::LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) OSC_LOG(::Log::LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) OSC_LOG(::Log::LEVEL_ERROR, __VA_ARGS__)
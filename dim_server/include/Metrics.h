@@ -0,0 +1,92 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+#include "Constants.h"
+
+// Names the calling thread (visible in /proc/self/task/<tid>/comm, top -H, gdb). Max 15 characters.
+void set_current_thread_name(const char* name);
+
+// Health counters of the server. Each thread increments its own block of relaxed atomics
+// (single writer, no contention, no locks after the first use on a thread); snapshot() sums the
+// blocks and turns totals into rates. Call snapshot() from one thread only, off the hot path.
+class Metrics {
+public:
+    enum Counter {
+        COMMANDS_SENT,
+        REPLIES_OK,
+        REPLIES_ERROR,          // Python answered with status != ok
+        ERR_NOT_CONNECTED,      // Command dropped: no Python client yet
+        ERR_MALFORMED_JSON,     // Unparsable message on the ROUTER socket
+        ERR_BAD_TOPIC,          // Unroutable waveform topic
+        ERR_REPLY_EXPIRED,      // Command never answered
+        ERR_QUEUE_FULL,         // Command or control message dropped: too many messages waiting for the ROUTER thread
+        ERR_FRAME_DROPPED,      // Received frame dropped: its publisher's queue was full
+        ERR_UNKNOWN_CLIENT,     // Message from a DEALER other than the handshaken backend, or another instrument's handshake
+        ERR_BACKEND_LOST,       // The active backend's heartbeats stopped
+        ERR_COMMAND_FAILED,     // Pending command failed because its backend was lost
+        FAILOVERS,              // Standby backend promoted
+        SETTINGS_ANSWERED,      // RAW query answered from the settings mirror, without the backend
+        COUNTER_COUNT
+    };
+
+    enum Topic {
+        TOPIC_STATE,
+        TOPIC_TIMEDIV,
+        TOPIC_TIMING,
+        TOPIC_SEQUENCE,
+        TOPIC_WAVEFORM_CH1,     // ... one per channel
+        TOPIC_OTHER = TOPIC_WAVEFORM_CH1 + Constants::OSC_NUM_CHANNELS,
+        TOPIC_COUNT
+    };
+
+    Metrics();
+
+    void add(Counter counter, uint64_t n = 1);
+    void add_message(Topic topic, uint64_t bytes);
+
+    // Gauges set by their single owner.
+    void set_pending_commands(uint64_t pending) { pending_commands.store(pending, std::memory_order_relaxed); }
+    void set_buffer_bytes(uint64_t bytes) { buffer_bytes.store(bytes, std::memory_order_relaxed); }
+
+    // Totals, per-second rates since the previous call, per-thread CPU and memory, as JSON.
+    nlohmann::json snapshot(const nlohmann::json& reply_latency);
+
+private:
+    struct ThreadBlock {
+        std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+        std::array<std::atomic<uint64_t>, TOPIC_COUNT> messages{};
+        std::array<std::atomic<uint64_t>, TOPIC_COUNT> bytes{};
+    };
+    struct Totals {
+        std::array<uint64_t, COUNTER_COUNT> counters{};
+        std::array<uint64_t, TOPIC_COUNT> messages{};
+        std::array<uint64_t, TOPIC_COUNT> bytes{};
+    };
+
+    ThreadBlock& local_block();
+    Totals sum_blocks();
+    nlohmann::json thread_cpu(double elapsed_s);
+
+    const uint64_t instance_id;
+    std::mutex blocks_mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadBlock>> blocks;
+
+    std::atomic<uint64_t> pending_commands{0};
+    std::atomic<uint64_t> buffer_bytes{0};
+
+    // Aggregation state (snapshot() thread only)
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point last_snapshot;
+    Totals last_totals;
+    std::map<int, uint64_t> last_thread_ticks;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+
+// Destination for everything the server publishes (replies, state, waveforms).
+// ZmqCommunicator only talks to this interface; the DIM implementation lives in DimServices.h,
+// the in-memory ones below let the ZMQ-to-publish path run without a DIM DNS.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual void update(const std::string& new_data) = 0;
+
+    // Number of clients currently reading this sink, or -1 if the sink cannot tell.
+    virtual int subscribers() { return -1; }
+};
+
+// Creates the sinks for the services a ZmqCommunicator publishes to.
+class SinkFactory {
+public:
+    virtual ~SinkFactory() = default;
+    virtual std::unique_ptr<OutputSink> create(const std::string& name, size_t buffer_size) = 0;
+};
+
+// Copies each update into a preallocated buffer (same truncation as the DIM service) and counts it.
+class CountingSink : public OutputSink {
+public:
+    CountingSink(std::string name, size_t buffer_size);
+
+    void update(const std::string& new_data) override;
+
+    // Unknown (-1) until a test sets it.
+    int subscribers() override { return subscriber_count.load(std::memory_order_relaxed); }
+    void set_subscribers(int count) { subscriber_count.store(count, std::memory_order_relaxed); }
+
+    const std::string& name() const { return sink_name; }
+    uint64_t updates() const { return update_count.load(std::memory_order_relaxed); }
+    uint64_t bytes() const { return byte_count.load(std::memory_order_relaxed); }
+    std::string last();
+
+private:
+    std::string sink_name;
+    std::mutex mtx;
+    std::vector<char> buffer;
+    size_t length = 0;
+    std::atomic<uint64_t> update_count{0};
+    std::atomic<uint64_t> byte_count{0};
+    std::atomic<int> subscriber_count{-1};
+};
+
+// Discards everything.
+class NullSink : public OutputSink {
+public:
+    void update(const std::string&) override {}
+};
+
+// Keeps a non-owning list of the sinks it created so a benchmark or soak test can inspect them.
+// Sinks are owned by the caller of create(); do not query the factory after they are destroyed.
+class CountingSinkFactory : public SinkFactory {
+public:
+    std::unique_ptr<OutputSink> create(const std::string& name, size_t buffer_size) override;
+
+    CountingSink* find(const std::string& name);
+    uint64_t total_updates();
+    uint64_t total_bytes();
+
+private:
+    std::mutex mtx;
+    std::vector<CountingSink*> sinks;
+};
+
+class NullSinkFactory : public SinkFactory {
+public:
+    std::unique_ptr<OutputSink> create(const std::string&, size_t) override {
+        return std::make_unique<NullSink>();
+    }
+};
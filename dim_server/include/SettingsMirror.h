@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include "Constants.h"
+
+// The server's copy of the scope settings, published as SCOPE/SETTINGS. It is replaced by the
+// backend's periodic readback of the whole setup (one consolidated query) and patched by every set
+// command once the backend answered it ok.
+//
+// The readback also carries the scope's answer to each query as it sent it, so the usual RAW queries
+// ("CH1:SCALE?", "TRIG:A:LEV?") are answered with the same string the scope would send, without a
+// round trip. A set command forgets the answer it changes until the next readback, which the backend
+// takes right after it.
+//
+// A query is answered only while no command that changes settings is waiting for its reply: the
+// scope would have executed that command first. RAW writes, setup recalls and sequences can change
+// anything, so they leave the mirror unknown until the readback that follows them. Every setting
+// starts unknown (null).
+//
+// Readbacks and replies arrive in order on the backend's DEALER, so a readback taken before a
+// command never overwrites that command's patch.
+class SettingsMirror {
+public:
+    SettingsMirror();
+
+    // A command is about to be sent (any thread). Commands that change no setting are ignored.
+    void sent(const nlohmann::json& request);
+
+    // The backend answered command 'id'. Returns true if the mirror changed.
+    bool replied(const std::string& id, bool ok);
+
+    // Command 'id' will never be answered (dropped, expired, or its backend was lost): its effect on
+    // the scope is unknown. Returns true if the mirror changed.
+    bool lost(const std::string& id);
+
+    // A readback ("settings" message from the backend) replaces the whole mirror.
+    void readback(const nlohmann::json& settings);
+
+    // The answer to a single RAW query, verbatim from the last readback ("5.0E-2", "RISE", "1"), or ""
+    // if the query is not mirrored or its answer is not known right now.
+    std::string answer(const std::string& query);
+
+    // channels, horizontal, trigger, acquisition; readbacks; changes_pending.
+    nlohmann::json snapshot();
+
+private:
+    static nlohmann::json unknown();
+    void apply(const nlohmann::json& request);
+
+    std::mutex mutex;
+    nlohmann::json settings;
+    nlohmann::json answers;     // The scope's strings, in the layout of 'settings'
+    std::map<std::string, nlohmann::json> pending;     // Settings-changing commands by id
+    uint64_t readbacks = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Bounded single-producer single-consumer queue: a power-of-two ring with free-running head/tail
+// counters, as the logger's per-thread rings. Neither side locks or allocates after construction.
+template <typename T>
+class SpscQueue {
+public:
+    // 'capacity' is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity) : slots(round_up(capacity)), mask(slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Leaves 'item' untouched and returns false when the queue is full.
+    bool try_push(T& item) {
+        uint64_t head_now = head.load(std::memory_order_relaxed);
+        if (head_now - tail.load(std::memory_order_acquire) > mask) return false;
+        slots[head_now & mask] = std::move(item);
+        head.store(head_now + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only.
+    bool try_pop(T& item) {
+        uint64_t tail_now = tail.load(std::memory_order_relaxed);
+        if (tail_now == head.load(std::memory_order_acquire)) return false;
+        item = std::move(slots[tail_now & mask]);
+        tail.store(tail_now + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const { return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire); }
+    size_t size() const { return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)); }
+    size_t capacity() const { return slots.size(); }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t size = 1;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    std::vector<T> slots;
+    const uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};   // Next slot to write, owned by the producer
+    alignas(64) std::atomic<uint64_t> tail{0};   // Next slot to read, owned by the consumer
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "TaskPool.h"
+
+// The analysis tasks of one frame and the order between them, e.g. parse -> auto_range. A task is
+// handed to the pool once all its dependencies finished; run() is the frame-completion barrier the
+// publisher waits on before it updates the frame's services.
+//
+// Built and run by one thread; a graph is not reused.
+class TaskGraph {
+public:
+    using Id = size_t;
+
+    explicit TaskGraph(TaskPool& pool);
+
+    // 'name' is the key of the task's run time in TaskPool::status().
+    Id add(std::string name, std::function<void()> fn, std::initializer_list<Id> after = {});
+
+    bool empty() const { return nodes.empty(); }
+
+    // Submits the tasks without dependencies and blocks until every task ran. Rethrows the first
+    // exception of a task; the tasks depending on it still run.
+    void run();
+
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> fn;
+        std::vector<Id> dependents;
+        std::atomic<int> remaining{0};      // Dependencies not finished yet
+    };
+
+    void execute(Id id);
+
+    TaskPool& pool;
+    std::deque<Node> nodes;     // A deque: Node holds an atomic and cannot move
+
+    std::mutex done_mutex;
+    std::condition_variable done;
+    size_t unfinished = 0;      // Guarded by done_mutex
+    std::exception_ptr error;   // Guarded by done_mutex
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "LatencyHistogram.h"
+
+// Work-stealing pool for the analysis kernels of the waveform frames. Every worker has its own
+// deque: a worker pushes and pops its own tasks at the back (the task it just made ready is the
+// one whose data is still in cache), idle workers steal from the front of the others. Tasks from
+// outside the pool (the channel publishers) are dealt round-robin over the workers.
+//
+// With no workers every task runs inline on the submitting thread.
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskPool(size_t workers);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    void start();
+    // Runs what is still queued, then joins the workers.
+    void stop();
+
+    // From any thread, including a task.
+    void submit(Task task);
+
+    // Run time of each task name, for SCOPE/METRICS. Histograms are created on first use and kept.
+    LatencyHistogram& timing(const std::string& name);
+
+    // workers, executed, stolen and the timing summary of every task name.
+    nlohmann::json status() const;
+
+private:
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    bool take(size_t index, Task& task);
+    void run(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> next_worker{0};
+
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    std::atomic<size_t> pending{0};     // Tasks in the deques; only raised under idle_mutex
+    std::atomic<bool> running{false};
+
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> stolen{0};
+
+    mutable std::mutex timings_mutex;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> timings;
+};
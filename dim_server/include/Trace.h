@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Opt-in timeline tracing, exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+//   void ZmqCommunicator::dispatch(const Frame& frame) {
+//       OSC_TRACE_SCOPE("dispatch");
+//
+// Every thread records complete events into its own fixed-size ring (the last EVENTS_PER_THREAD are
+// kept, a flight recorder for "what was each thread doing when it stalled"). Names must be string
+// literals. While tracing is disabled a scope costs one relaxed load.
+namespace Trace {
+    constexpr size_t EVENTS_PER_THREAD = 16384;   // Power of two
+    constexpr int64_t NO_VALUE = INT64_MIN;
+
+    extern std::atomic<bool> active;
+
+    inline bool enabled() { return active.load(std::memory_order_relaxed); }
+    void set_enabled(bool enabled);
+
+    void record(const char* name, int64_t start_ns, int64_t end_ns, int64_t value);
+
+    // Writes the buffered events of all threads to 'path'. Returns the number of events written,
+    // or -1 if the file cannot be opened.
+    long dump(const std::string& path);
+
+    // /tmp/osc_dim_trace_<pid>_<n>.json
+    std::string default_path();
+
+    // SIGUSR1 asks for a dump to default_path(); the dump itself runs in service_signal(),
+    // called periodically from a normal thread (file I/O is not async-signal-safe).
+    void install_signal_handler();
+    void service_signal();
+
+    class Scope {
+    public:
+        explicit Scope(const char* event_name, int64_t event_value = NO_VALUE) :
+            name(enabled() ? event_name : nullptr), value(event_value), start_ns(name ? now_ns() : 0) {}
+        ~Scope() {
+            if (name) record(name, start_ns, now_ns(), value);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        static int64_t now_ns();
+
+        const char* name;
+        int64_t value;
+        int64_t start_ns;
+    };
+}
+
+#define OSC_TRACE_CONCAT_INNER(a, b) a##b
+#define OSC_TRACE_CONCAT(a, b) OSC_TRACE_CONCAT_INNER(a, b)
+
+// Traces the enclosing block; the _VALUE form attaches an integer (channel, bytes, ...) to the event.
+#define OSC_TRACE_SCOPE(name) ::Trace::Scope OSC_TRACE_CONCAT(osc_trace_scope_, __COUNTER__)(name)
+#define OSC_TRACE_SCOPE_VALUE(name, value) \
+    ::Trace::Scope OSC_TRACE_CONCAT(osc_trace_scope_, __COUNTER__)(name, static_cast<int64_t>(value))
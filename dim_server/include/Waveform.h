@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Text encoding of the CH<x> services: samples in "%.6E" notation joined with ','.
+// This mirrors the formatting done by the Python backend before publishing to DIM.
+namespace Waveform {
+    // Maximum length of one formatted sample, e.g. "-1.234567E-03".
+    constexpr size_t MAX_SAMPLE_CHARS = 13;
+
+    // Appends the comma separated representation of the samples to 'out' (which is cleared first).
+    void format(const double* samples, size_t count, std::string& out);
+
+    // Parses a comma separated payload into 'out' (which is cleared first).
+    // Returns false if a field could not be converted; 'out' then holds the samples parsed so far.
+    bool parse(const std::string& payload, std::vector<double>& out);
+}
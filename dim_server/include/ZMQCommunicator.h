@@ -1,49 +1,199 @@
 #pragma once
+#include <array>
 #include <string>
 #include <vector>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <memory>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <condition_variable>
 
 // Internal libraries
-#include "DimServices.h"
+#include "OutputSink.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "DutyCycle.h"
+#include "AutoRange.h"
+#include "FramePublisher.h"
+#include "TaskPool.h"
+#include "Instrument.h"
+#include "CommandPriority.h"
+#include "SettingsMirror.h"
+#include "Constants.h"
 
 // External libraries
 #include <zmq.hpp>
-#include <dis.hxx> 
-
-// Forward declaration to avoid circular dependencies
-class ReplyService;
 
 class ZmqCommunicator {
+    const Instrument instrument;
     zmq::context_t context;
-    std::mutex client_id_mutex;
     std::atomic<bool> running;
-    zmq::message_t python_client_id;
+
+    // A backend process as the ROUTER thread knows it. Backends running a heartbeat thread say hello
+    // from a second DEALER and echo the heartbeats sent there while they are healthy.
+    struct BackendLink {
+        std::string backend;            // Id from the handshake; empty for backends that sent none
+        zmq::message_t dealer;          // Commands and replies
+        bool handshaken = false;
+        zmq::message_t heartbeat_dealer;
+        bool beating = false;           // Its heartbeat DEALER said hello
+        int64_t last_beat_ns = 0;
+        std::string publish_endpoint;   // Its PUB socket, connected by the SUB socket
+    };
+
+    // Router thread only. The active backend gets the commands; it is set by a handshake for this
+    // instrument, or else is the first DEALER heard from (a backend already running before a restart).
+    // A standby is subscribed and beating, and is promoted when the active one's heartbeats stop.
+    std::unique_ptr<BackendLink> active;
+    std::unique_ptr<BackendLink> standby;
+    std::atomic<bool> client_connected{false};
+    std::atomic<bool> active_lost{false};       // Heartbeats stopped and no standby took over
+
+    // Heartbeats (router thread only, except what the metrics thread reads)
+    uint64_t heartbeat_seq = 0;
+    int64_t next_heartbeat_ns = 0;
+    LatencyHistogram heartbeat_rtt;             // Of the active backend
+    std::mutex heartbeat_mutex;
+    nlohmann::json heartbeat_status;            // Refreshed at every heartbeat, for SCOPE/METRICS
+
+    // Backend PUB endpoints for the SUB socket to connect (true) or disconnect, handed from the
+    // router thread to the subscribe thread.
+    std::mutex sub_changes_mutex;
+    std::vector<std::pair<bool, std::string>> sub_changes;
+    std::set<std::string> sub_endpoints;        // router thread only: connected, or about to be
+    std::string default_sub_endpoint;           // The PUB of backends that give none at the handshake
+
+    // Only the ROUTER thread uses the ROUTER socket: other threads queue their messages here and
+    // wake it through the inproc PAIR (wake_send is used under outgoing_mutex).
+    struct Outgoing {
+        std::string json_str;
+        std::string command_id;
+        bool is_command;
+        CommandPriority priority;
+    };
+    std::mutex outgoing_mutex;
+    std::deque<Outgoing> outgoing_control;      // Sent first
+    std::deque<Outgoing> outgoing;              // Commands in order; a stop is moved up (see CommandPriority)
 
     // Sockets
     zmq::socket_t router_socket;
     zmq::socket_t sub_socket;
+    zmq::socket_t wake_receive;     // Router thread
+    zmq::socket_t wake_send;
 
     // Threads
     std::thread router_thread;
     std::thread sub_thread;
+    std::thread metrics_thread;
+    std::mutex metrics_mutex;
+    std::condition_variable metrics_wakeup;
 
     // Services
-    ReplyService& reply_svc;
-    ProtectedDimService state_svc;
-    ProtectedDimService timediv_svc;
-    std::vector<std::unique_ptr<ProtectedDimService>> waveform_svcs;
+    OutputSink& reply_svc;
+    std::unique_ptr<OutputSink> state_svc;
+    std::unique_ptr<OutputSink> timediv_svc;
+    std::vector<std::unique_ptr<OutputSink>> waveform_svcs;
+    std::vector<std::unique_ptr<OutputSink>> meta_svcs;      // CH<x>/META: the frame header without the trace
+    std::unique_ptr<OutputSink> latency_svc;
+    std::unique_ptr<OutputSink> metrics_svc;
+    std::unique_ptr<OutputSink> timing_svc;
+    std::unique_ptr<OutputSink> sequence_svc;
+    std::unique_ptr<OutputSink> auto_range_svc;
+    std::unique_ptr<OutputSink> setup_slots_svc;
+    std::unique_ptr<OutputSink> settings_svc;
+
+    LatencyTracer latency;
+    Metrics metrics;
+    DutyCycle duty_cycle;   // 'other' publisher only
+    AutoRange auto_range;
+    std::vector<std::vector<double>> range_samples;     // per channel, used by that channel's publisher only
+    std::atomic<long> auto_range_counter{0};
+    std::array<uint64_t, Constants::OSC_NUM_CHANNELS> published_frames{};   // per channel, used by that channel's publisher only
+
+    // Runs the analysis tasks of the waveform frames; each publisher waits for its frame's tasks
+    // before it updates the frame's services.
+    TaskPool analysis_pool;
+
+    // Frames go from the subscribe thread to one publisher per channel, plus one for the other topics
+    // (last). Each publisher updates its own services, so channels no longer wait for each other.
+    std::vector<std::unique_ptr<FramePublisher>> publishers;
+
+    // Demand: the sinks whose readers need each channel's waveform (the CH<x> service and anything
+    // derived from it). The backend only transfers channels with at least one reader.
+    std::vector<std::vector<OutputSink*>> channel_sinks;
+    std::vector<int> wanted_channels;           // metrics thread only
+    std::atomic<bool> demand_resend{true};      // set when the backend (re)connects
+
+    // Credit flow control: the backend publishes at most CREDIT_WINDOW waveform frames beyond the
+    // cumulative count consumed here, so every queue on the way stays bounded. Grants carry the
+    // count itself, which makes a lost or repeated grant harmless.
+    const int64_t credit_epoch;                 // Tells the backend this server instance from a restarted one
+    std::atomic<uint64_t> frames_consumed{0};
+    std::atomic<uint64_t> granted_consumed{0};  // frames_consumed in the last grant
+
+    // Commands sent and not yet answered, oldest first: (id, monotonic_ns() at send)
+    std::mutex pending_mutex;
+    std::deque<std::pair<std::string, int64_t>> pending_commands;
+    LatencyHistogram reply_latency;
+
+    // SCOPE/SETTINGS, which also answers the usual RAW queries
+    SettingsMirror settings_mirror;
 
 public:
-    ZmqCommunicator(ReplyService& service);
+    // All services except the reply are created through 'sinks' (DimSinkFactory in production).
+    // Service names get the instrument's prefix. 'analysis_threads' sizes the analysis pool; 0 runs
+    // the analysis on the publisher threads.
+    ZmqCommunicator(OutputSink& reply, SinkFactory& sinks, const Instrument& instrument = Instrument::numbered(1, 1),
+                    size_t analysis_threads = Constants::ANALYSIS_THREADS);
     ~ZmqCommunicator();
 
     void start(const std::string& router_endpoint, const std::string& sub_endpoint);
     void stop();
     void send_command(const std::string& json_str);
 
+    // A DIM command whose input the server rejects: answered on SCOPE/REPLY, never sent.
+    void reject_command(const std::string& command, const std::string& message);
+
+    // SCOPE/RAW: answers a query from the settings mirror, if it knows the value and no command is
+    // waiting for its reply. Returns false if the query must go to the scope.
+    bool answer_from_settings(const std::string& query);
+
+    // A SCOPE/... service or command name in this instrument's namespace.
+    std::string service_name(const std::string& name) const { return instrument.service(name); }
+
+    // SCOPE/CHANNEL/SET_AUTO_RANGE: starts (or stops) ranging one channel (0-based).
+    void set_auto_range(int channel, bool enabled);
+
+    // Updates the DIM service of one received frame and records its trace header, if any.
+    // Called on the frame's publisher thread.
+    void dispatch(const Frame& frame);
+
 private:
     void router_loop();
+    void handle_backend_message(zmq::message_t& sender, const std::string& text);
+    void handle_handshake(zmq::message_t& sender, const nlohmann::json& message);
+    void handle_heartbeat(zmq::message_t& sender, const nlohmann::json& message);
+    void heartbeat_tick(int64_t now_ns);
+    void lose_active();
+    void fail_pending_commands();
+    void publish_settings();
+    void set_subscribed(const std::string& endpoint, bool connected);
+    void send_to(zmq::message_t& identity, const std::string& json_str);
     void subscribe_loop();
+    void metrics_loop();
+    void command_sent(const std::string& id);
+    void reply_received(const std::string& id);
+    void expire_pending_commands();
+    void send_control(const std::string& json_str);
+    bool enqueue(const std::string& json_str, CommandPriority priority, const std::string& command_id, bool is_command);
+    void flush_outgoing();
+    void fail_unsent(const std::deque<Outgoing>& batch);
+    void drop_pending(const std::string& id);
+    void grant_credit();
+    void return_credit();
+    void route(Frame& frame);
+    void update_demand();
 };
\ No newline at end of file
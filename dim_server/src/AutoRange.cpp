@@ -0,0 +1,100 @@
+#include "AutoRange.h"
+#include <algorithm>
+#include <cmath>
+
+using json = nlohmann::json;
+
+namespace {
+    const char* STATE_NAMES[] = {"off", "seeking", "locked", "failed"};
+
+    bool same_scale(double a, double b) {
+        return std::fabs(a - b) <= 1e-3 * std::max(std::fabs(a), std::fabs(b));
+    }
+}
+
+void AutoRange::set_enabled(int channel, bool enabled) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Channel& ch = channels.at(channel);
+    ch = Channel();
+    ch.state = enabled ? SEEKING : OFF;
+}
+
+bool AutoRange::seeking(int channel) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return channels.at(channel).state == SEEKING;
+}
+
+double AutoRange::ladder_at_least(double volts_per_div) {
+    if (volts_per_div <= MIN_SCALE) return MIN_SCALE;
+    double decade = std::pow(10.0, std::floor(std::log10(volts_per_div)));
+    for (double mantissa : {1.0, 2.0, 5.0, 10.0}) {
+        // Tolerate rounding, so a value already on the ladder maps to itself.
+        if (mantissa * decade >= volts_per_div * (1.0 - 1e-9)) return std::min(mantissa * decade, MAX_SCALE);
+    }
+    return MAX_SCALE;
+}
+
+AutoRange::Decision AutoRange::evaluate(int channel, const std::vector<double>& samples, double scale) {
+    Decision decision;
+    if (samples.empty() || scale <= 0.0) return decision;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    Channel& ch = channels.at(channel);
+    if (ch.state != SEEKING) return decision;
+
+    if (ch.pending_scale > 0.0) {
+        if (!same_scale(scale, ch.pending_scale)) {
+            ++ch.skipped;
+            decision.publish = false;
+            return decision;
+        }
+        ch.pending_scale = 0.0;
+    }
+
+    auto extrema = std::minmax_element(samples.begin(), samples.end());
+    double peak = std::max(std::fabs(*extrema.first), std::fabs(*extrema.second));
+    double rail = RAIL_DIVS * scale * 0.99;
+    ch.rail_hits = std::count_if(samples.begin(), samples.end(), [rail](double v) { return std::fabs(v) >= rail; });
+    ch.peak_divs = peak / scale;
+    ch.scale = scale;
+
+    double target = scale;
+    if (ch.rail_hits >= MIN_RAIL_HITS) {
+        target = ladder_at_least(scale * CLIP_FACTOR);
+    } else if (ch.peak_divs < LOW_DIVS || ch.peak_divs > HIGH_DIVS) {
+        target = ladder_at_least(peak / TARGET_DIVS);
+    }
+
+    if (same_scale(target, scale)) {
+        // In the band, or already at the end of the ladder: nothing better to try.
+        ch.state = (ch.rail_hits >= MIN_RAIL_HITS || ch.peak_divs > HIGH_DIVS) ? FAILED : LOCKED;
+        return decision;
+    }
+    if (ch.changes >= MAX_CHANGES) {
+        ch.state = FAILED;
+        return decision;
+    }
+
+    ++ch.changes;
+    ch.pending_scale = target;
+    decision.new_scale = target;
+    return decision;
+}
+
+json AutoRange::status() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    json j = json::array();
+    for (size_t i = 0; i < channels.size(); ++i) {
+        const Channel& ch = channels[i];
+        j.push_back({
+            {"channel", i + 1},
+            {"state", STATE_NAMES[ch.state]},
+            {"scale", ch.scale},
+            {"peak_divs", ch.peak_divs},
+            {"rail_hits", ch.rail_hits},
+            {"changes", ch.changes},
+            {"skipped", ch.skipped}
+        });
+    }
+    return j;
+}
@@ -2,6 +2,10 @@
 #include "ZMQCommunicator.h"
 #include "DimServices.h"
 #include "Constants.h"
+#include "Log.h"
+#include "Trace.h"
+
+#include <stdexcept>
 
 using json = nlohmann::json;
 
@@ -14,21 +18,35 @@ FlexibleJsonCommand::FlexibleJsonCommand(ZmqCommunicator& comm, const char* dim_
 {}
 
 void FlexibleJsonCommand::commandHandler() {
+    OSC_TRACE_SCOPE("command/handle");
+    std::string request;
+    try {
+        request = build_request();
+    } catch (const std::invalid_argument& e) {
+        zmq_comm.reject_command(getName(), e.what());
+        return;
+    }
+    zmq_comm.send_command(request);
+}
+
+std::string FlexibleJsonCommand::build_request() {
     json j;
     j[Constants::JSON_ID] = python_command + "_" + std::to_string(command_counter++);
     j[Constants::JSON_COMMAND] = python_command;
 
     populator(this, j[Constants::JSON_PARAMS]);
 
-    zmq_comm.send_command(j.dump());
+    return j.dump();
 }
 
 
 RawCommandService::RawCommandService(ZmqCommunicator& comm) :
-    DimCommand(Constants::RAW_CMD, "C"), zmq_comm(comm) {}
+    DimCommand(comm.service_name(Constants::RAW_CMD).c_str(), "C"), zmq_comm(comm) {}
 
 void RawCommandService::commandHandler() {
+    OSC_TRACE_SCOPE("command/raw");
     std::string cmd_text = getString();
+    if (zmq_comm.answer_from_settings(cmd_text)) return;
     json j;
     j[Constants::JSON_ID] = "raw_cmd_" + std::to_string(command_counter++);
     j[Constants::JSON_TYPE] = "command";
@@ -40,4 +58,40 @@ void RawCommandService::commandHandler() {
         j[Constants::JSON_PARAMS] = { {Constants::JSON_COMMAND, cmd_text} };
     }
     zmq_comm.send_command(j.dump());
+}
+
+
+AutoRangeCommand::AutoRangeCommand(ZmqCommunicator& comm) :
+    DimCommand(comm.service_name(Constants::CHAN_SET_AUTO_RANGE_CMD).c_str(), "I:1;I:1"), zmq_comm(comm) {}
+
+void AutoRangeCommand::commandHandler() {
+    if (getSize() < static_cast<int>(2 * sizeof(int))) {
+        LOG_WARN("Ignoring {}: {} bytes, expected two ints", getName(), getSize());
+        return;
+    }
+    const int* data = static_cast<const int*>(getData());
+    int channel = data[0];
+    if (channel < 1 || channel > Constants::OSC_NUM_CHANNELS) {
+        LOG_WARN("Ignoring {} for channel {}", getName(), channel);
+        return;
+    }
+    zmq_comm.set_auto_range(channel - 1, data[1] != 0);
+}
+
+
+TraceCommand::TraceCommand() :
+    DimCommand(Constants::TRACE_CMD, "C") {}
+
+void TraceCommand::commandHandler() {
+    std::string text = getString();
+    if (text == "ON") {
+        Trace::set_enabled(true);
+    } else if (text == "OFF") {
+        Trace::set_enabled(false);
+    } else if (text == "DUMP") {
+        // Any DIM client may send this, so it never chooses where the server writes.
+        Trace::dump(Trace::default_path());
+    } else {
+        LOG_WARN("Unknown {} argument '{}' (expected ON, OFF or DUMP)", Constants::TRACE_CMD, text);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+#include "CommandPriority.h"
+#include "Constants.h"
+
+#include <algorithm>
+#include <cctype>
+
+CommandPriority command_priority(const nlohmann::json& request) {
+    if (!request.is_object()) return CommandPriority::NORMAL;
+    if (request.value(Constants::JSON_TYPE, "") == "control") return CommandPriority::CONTROL;
+
+    std::string command = request.value(Constants::JSON_COMMAND, "");
+    if (command == Constants::PY_SET_ACQ_MODE) {
+        std::string state;
+        auto params = request.find(Constants::JSON_PARAMS);
+        if (params != request.end() && params->is_object()) state = params->value("state", "");
+        std::transform(state.begin(), state.end(), state.begin(), [](unsigned char c) { return std::toupper(c); });
+        return state == "OFF" ? CommandPriority::ABORT : CommandPriority::MODE;
+    }
+    if (command == Constants::PY_RUN_SEQUENCE) return CommandPriority::MODE;
+    return CommandPriority::NORMAL;
+}
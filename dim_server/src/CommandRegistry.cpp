@@ -3,64 +3,124 @@
 #include "ZMQCommunicator.h"
 #include "Constants.h"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
 using json = nlohmann::json;
 
 void register_all_commands(ZmqCommunicator& comm) {
+    // Every name is put in the instrument's namespace (SCOPE<n>/... with several instruments).
 
     // --- Register Generic Commands using Lambdas ---
     // SCOPE/TRIGGER/SET_CHANNEL (String parameter)
-    new FlexibleJsonCommand(comm, Constants::TRIG_SET_CHANNEL_CMD, "I", Constants::PY_SET_TRIG_CHANNEL,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::TRIG_SET_CHANNEL_CMD).c_str(), "I", Constants::PY_SET_TRIG_CHANNEL,
         [](DimCommand* cmd, json& params) {
             params["channel"] = cmd->getInt();
         }
     );
     // SCOPE/TRIGGER/SET_SLOPE (String parameter)
-    new FlexibleJsonCommand(comm, Constants::TRIG_SET_SLOPE_CMD, "C", Constants::PY_SET_TRIG_SLOPE,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::TRIG_SET_SLOPE_CMD).c_str(), "C", Constants::PY_SET_TRIG_SLOPE,
         [](DimCommand* cmd, json& params) {
             params["slope"] = cmd->getString();
         }
     );
 
     // SCOPE/TRIGGER/SET_LEVEL (Float parameter)
-    new FlexibleJsonCommand(comm, Constants::TRIG_SET_LEVEL_CMD, "F", Constants::PY_SET_TRIG_LEVEL,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::TRIG_SET_LEVEL_CMD).c_str(), "F", Constants::PY_SET_TRIG_LEVEL,
         [](DimCommand* cmd, json& params) {
             params["level"] = cmd->getFloat();
         }
     );
 
     // SCOPE/ACQUISITION/SET_TIMEDIV (Float parameter)
-    new FlexibleJsonCommand(comm, Constants::ACQ_SET_TIMEDIV_CMD, "F", Constants::PY_SET_ACQ_TIMEDIV,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_TIMEDIV_CMD).c_str(), "F", Constants::PY_SET_ACQ_TIMEDIV,
         [](DimCommand* cmd, json& params) {
             params["level"] = cmd->getFloat();
         }
     );
 
     // SCOPE/ACQUISITION/SET_TIMEOUT (Float parameter)
-    new FlexibleJsonCommand(comm, Constants::ACQ_SET_TIMEOUT_CMD, "F", Constants::PY_SET_ACQ_TIMEOUT,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_TIMEOUT_CMD).c_str(), "F", Constants::PY_SET_ACQ_TIMEOUT,
         [](DimCommand* cmd, json& params) {
             params["level"] = cmd->getFloat();
         }
     );
 
     // SCOPE/ACQUISITION/IGNORE_TIMEOUT (Char parameter -- interpreted as bool)
-    new FlexibleJsonCommand(comm, Constants::ACQ_SET_IGNORE_CMD, "I:1", Constants::PY_SET_ACQ_IGNORE,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_IGNORE_CMD).c_str(), "I:1", Constants::PY_SET_ACQ_IGNORE,
         [](DimCommand* cmd, json& params) {
             params["state"] = (cmd->getInt() != 0);
         }
     );
 
     // SCOPE/ACQUISITION/SET_STATE (String parameter)
-    new FlexibleJsonCommand(comm, Constants::ACQ_SET_MODE_CMD, "C", Constants::PY_SET_ACQ_MODE,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_MODE_CMD).c_str(), "C", Constants::PY_SET_ACQ_MODE,
         [](DimCommand* cmd, json& params) {
             params["state"] = cmd->getString();
         }
     );
 
 
+    // SCOPE/ACQUISITION/SET_WINDOW (Start + Stop sample; 0;0 restores the full record)
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_WINDOW_CMD).c_str(), "I:1;I:1", Constants::PY_SET_ACQ_WINDOW,
+        [](DimCommand* cmd, json& params) {
+            auto* data = static_cast<WindowCommandData*>(cmd->getData());
+            params["start"] = data->start;
+            params["stop"] = data->stop;
+        }
+    );
+
+
+    // SCOPE/ACQUISITION/SET_SAMPLING (String parameter: "SAMPLE", "AVERAGE;<n>" or "ENVELOPE;<n>")
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::ACQ_SET_SAMPLING_CMD).c_str(), "C", Constants::PY_SET_ACQ_SAMPLING,
+        [](DimCommand* cmd, json& params) {
+            std::string text = cmd->getString();
+            size_t separator = text.find(';');
+            std::string mode = text.substr(0, separator);
+            std::transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char c) { return std::toupper(c); });
+            if (mode != "SAMPLE" && mode != "AVERAGE" && mode != "ENVELOPE") {
+                throw std::invalid_argument("Sampling mode must be SAMPLE, AVERAGE or ENVELOPE, given '" + text.substr(0, separator) + "'");
+            }
+            params["mode"] = mode;
+            if (separator == std::string::npos) return;
+            // The whole rest must be the count: the backend checks its range.
+            std::string count_text = text.substr(separator + 1);
+            const char* end = count_text.data() + count_text.size();
+            int count = 0;
+            auto [parsed_end, error] = std::from_chars(count_text.data(), end, count);
+            if (count_text.empty() || error != std::errc() || parsed_end != end) {
+                throw std::invalid_argument("Sampling count must be an integer, given '" + count_text + "'");
+            }
+            params["count"] = count;
+        }
+    );
+
+    // SCOPE/SEQUENCE/RUN (JSON program, validated by the backend's sequencer)
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::SEQUENCE_RUN_CMD).c_str(), "C", Constants::PY_RUN_SEQUENCE,
+        [](DimCommand* cmd, json& params) {
+            params["program"] = cmd->getString();
+        }
+    );
+
+    // SCOPE/SETUP/SAVE and SCOPE/SETUP/RECALL (Integer parameter: instrument memory slot, 1-10)
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::SETUP_SAVE_CMD).c_str(), "I", Constants::PY_SAVE_SETUP,
+        [](DimCommand* cmd, json& params) {
+            params["slot"] = cmd->getInt();
+        }
+    );
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::SETUP_RECALL_CMD).c_str(), "I", Constants::PY_RECALL_SETUP,
+        [](DimCommand* cmd, json& params) {
+            params["slot"] = cmd->getInt();
+        }
+    );
+
+
     // --- Register Channel Commands using Lambdas ---
 
     // SCOPE/CHANNEL/SET_ENABLED (Channel + Value parameter)
-    new FlexibleJsonCommand(comm, Constants::CHAN_SET_ENABLED_CMD, "I:1;I:1", Constants::PY_SET_CHAN_ENABLED,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::CHAN_SET_ENABLED_CMD).c_str(), "I:1;I:1", Constants::PY_SET_CHAN_ENABLED,
         [](DimCommand* cmd, json& params) {
             auto* data = static_cast<ChannelCommandData*>(cmd->getData());
             params[Constants::JSON_CHANNEL] = data->channel;
@@ -69,7 +129,7 @@ void register_all_commands(ZmqCommunicator& comm) {
     );
 
     // SCOPE/CHANNEL/SET_SCALE (Channel + Value parameter)
-    new FlexibleJsonCommand(comm, Constants::CHAN_SET_SCALE_CMD, "I:1;F:1", Constants::PY_SET_CHAN_SCALE,
+    new FlexibleJsonCommand(comm, comm.service_name(Constants::CHAN_SET_SCALE_CMD).c_str(), "I:1;F:1", Constants::PY_SET_CHAN_SCALE,
         [](DimCommand* cmd, json& params) {
             auto* data = static_cast<ChannelCommandData*>(cmd->getData());
             params[Constants::JSON_CHANNEL] = data->channel;
@@ -80,4 +140,9 @@ void register_all_commands(ZmqCommunicator& comm) {
 
     // --- Register Specialized Commands ---
     new RawCommandService(comm);
+    new AutoRangeCommand(comm);
+}
+
+void register_server_commands() {
+    new TraceCommand();
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "DimServices.h"
 #include "Constants.h"
-#include <iostream>
+#include "Log.h"
+#include "Trace.h"
+#include <chrono>
 
 ProtectedDimService::ProtectedDimService(const std::string& name, size_t buffer_size) :
     buffer(buffer_size, '\0'), // Allocate buffer and initialize to null characters
@@ -9,25 +11,36 @@ ProtectedDimService::ProtectedDimService(const std::string& name, size_t buffer_
 }
 
 void ProtectedDimService::update(const std::string& new_data) {
-    std::lock_guard<std::mutex> lock(mtx);
-    // Use strncpy to copy data, ensuring null termination.
-    strncpy(buffer.data(), new_data.c_str(), buffer.size() - 1);
-    buffer.back() = '\0'; // Ensure the last character is always null.
-    service.updateService();
-    // For debugging:
-    // std::cout << "Updated " << service.getName() << " with data of size " << new_data.length() << std::endl;
+    OSC_TRACE_SCOPE_VALUE("dim/update", new_data.size());
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // Use strncpy to copy data, ensuring null termination.
+        strncpy(buffer.data(), new_data.c_str(), buffer.size() - 1);
+        buffer.back() = '\0'; // Ensure the last character is always null.
+
+        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        service.setTimestamp(static_cast<int>(now_ms / 1000), static_cast<int>(now_ms % 1000));
+        service.updateService();
+    }
+    LOG_DEBUG("Updated {} with data of size {}", service.getName(), new_data.length());
 }
 
-ReplyService::ReplyService() :
-    reply_service(Constants::REPLY_SERVICE, buffer)
+ReplyService::ReplyService() : ReplyService(Constants::REPLY_SERVICE) {}
+
+ReplyService::ReplyService(const std::string& name) :
+    reply_service(name.c_str(), buffer)
 {
     buffer[0] = '\0';
 }
 
 void ReplyService::update(const std::string& new_reply) {
-    std::lock_guard<std::mutex> lock(mtx);
-    strncpy(buffer, new_reply.c_str(), sizeof(buffer));
-    buffer[sizeof(buffer) - 1] = '\0';
-    reply_service.updateService();
-    std::cout << "Updated " << Constants::REPLY_SERVICE << " with: " << buffer << std::endl;
+    OSC_TRACE_SCOPE("dim/reply");
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        strncpy(buffer, new_reply.c_str(), sizeof(buffer));
+        buffer[sizeof(buffer) - 1] = '\0';
+        reply_service.updateService();
+    }
+    LOG_INFO("Updated {} with: {}", reply_service.getName(), new_reply);
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "DutyCycle.h"
+#include <algorithm>
+
+using json = nlohmann::json;
+
+namespace {
+    const char* PHASE_NAMES[DutyCycle::PHASE_COUNT] = {
+        "configure", "arm", "wait_for_trigger", "transfer", "format", "publish", "timediv", "other"
+    };
+
+    int64_t get_ns(const json& object, const char* key) {
+        auto it = object.find(key);
+        return (it != object.end() && it->is_number()) ? it->get<int64_t>() : 0;
+    }
+}
+
+bool DutyCycle::add(const json& timing) {
+    if (!timing.is_object() || !timing.contains("start") || !timing.contains("end")) return false;
+
+    Cycle cycle{};
+    int64_t start = get_ns(timing, "start");
+    cycle.end_ns = get_ns(timing, "end");
+    int64_t previous_end = get_ns(timing, "previous_end");
+    // The first cycle after a start has no predecessor: count it from its own start.
+    cycle.wall_ns = cycle.end_ns - (previous_end > 0 && previous_end <= start ? previous_end : start);
+    cycle.timeout = timing.value("timeout", false);
+    cycle.aborted = timing.value("aborted", false);
+    if (cycle.wall_ns <= 0) return false;
+
+    const json phases = timing.value("phases", json::object());
+    int64_t accounted = 0;
+    for (int phase = 0; phase < OTHER; ++phase) {
+        int64_t ns = 0;
+        auto it = phases.find(PHASE_NAMES[phase]);
+        if (it != phases.end() && it->is_object()) {
+            for (const auto& channel : *it) {
+                if (channel.is_number()) ns += channel.get<int64_t>();
+            }
+        } else {
+            ns = get_ns(phases, PHASE_NAMES[phase]);
+        }
+        cycle.phases[phase] = ns;
+        accounted += ns;
+    }
+    cycle.phases[OTHER] = std::max<int64_t>(0, cycle.wall_ns - accounted);
+
+    cycles.push_back(cycle);
+    while (!cycles.empty() && cycles.front().end_ns < cycle.end_ns - window_ns) cycles.pop_front();
+    last = timing;
+    return true;
+}
+
+json DutyCycle::summary() const {
+    json j;
+    j["window_s"] = window_ns / 1e9;
+    j["cycles"] = cycles.size();
+    if (cycles.empty()) return j;
+
+    std::array<int64_t, PHASE_COUNT> totals{};
+    int64_t wall = 0;
+    int timeouts = 0;
+    int aborted = 0;
+    for (const Cycle& cycle : cycles) {
+        for (int phase = 0; phase < PHASE_COUNT; ++phase) totals[phase] += cycle.phases[phase];
+        wall += cycle.wall_ns;
+        if (cycle.timeout) ++timeouts;
+        if (cycle.aborted) ++aborted;
+    }
+
+    j["cycle_rate_hz"] = cycles.size() * 1e9 / wall;
+    j["live_fraction"] = static_cast<double>(totals[WAIT_FOR_TRIGGER]) / wall;
+    j["timeouts"] = timeouts;
+    j["aborted"] = aborted;
+
+    json fractions, means;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        fractions[PHASE_NAMES[phase]] = static_cast<double>(totals[phase]) / wall;
+        means[PHASE_NAMES[phase]] = totals[phase] / 1e6 / cycles.size();
+    }
+    j["fraction"] = fractions;
+    j["mean_ms"] = means;
+    // The backend's timeout and BUSY? poll interval for the latest cycle, with the estimate behind them.
+    if (last.contains("acquisition_timeout")) j["acquisition_timeout"] = last["acquisition_timeout"];
+    if (last.contains("credit")) j["credit"] = last["credit"];
+    j["last"] = last;
+    return j;
+}
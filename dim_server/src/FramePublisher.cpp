@@ -0,0 +1,58 @@
+#include "FramePublisher.h"
+#include "Metrics.h"
+
+FramePublisher::FramePublisher(std::string thread_name, size_t capacity, Handler frame_handler) :
+    name(std::move(thread_name)),
+    queue(capacity),
+    handler(std::move(frame_handler))
+{
+}
+
+FramePublisher::~FramePublisher() {
+    stop();
+}
+
+void FramePublisher::start() {
+    running = true;
+    worker = std::thread(&FramePublisher::run, this);
+}
+
+void FramePublisher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    wakeup.notify_one();
+    if (worker.joinable()) worker.join();
+}
+
+bool FramePublisher::offer(Frame& frame) {
+    if (!queue.try_push(frame)) return false;
+    // The worker sets 'sleeping' before its last look at the queue, so either it sees this frame
+    // or it is already waiting when the lock below is released. The fences order each side's
+    // store before its load.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load()) {
+        { std::lock_guard<std::mutex> lock(mtx); }
+        wakeup.notify_one();
+    }
+    return true;
+}
+
+void FramePublisher::run() {
+    set_current_thread_name(name.c_str());
+    Frame frame;
+    while (true) {
+        while (queue.try_pop(frame)) {
+            handler(frame);
+            handled_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeup.wait(lock, [this] { return !queue.empty() || !running; });
+        sleeping = false;
+        if (!running && queue.empty()) return;
+    }
+}
@@ -0,0 +1,33 @@
+#include "Instrument.h"
+#include "Constants.h"
+
+namespace {
+    const std::string BASE_PREFIX = "SCOPE";
+
+    // "tcp://*:5555" moved by 'offset' -> "tcp://*:<5555 + offset>"
+    std::string offset_port(const std::string& endpoint, int offset) {
+        size_t colon = endpoint.rfind(':');
+        return endpoint.substr(0, colon + 1) + std::to_string(std::stoi(endpoint.substr(colon + 1)) + offset);
+    }
+}
+
+std::string Instrument::service(const std::string& name) const {
+    if (name.rfind(BASE_PREFIX, 0) != 0) return name;
+    return prefix + name.substr(BASE_PREFIX.size());
+}
+
+Instrument Instrument::numbered(int number, int count) {
+    Instrument instrument;
+    instrument.number = number;
+    if (count <= 1) {
+        instrument.prefix = BASE_PREFIX;
+        instrument.router_endpoint = Constants::ZMQ_ROUTER_ENDPOINT;
+        instrument.sub_endpoint = Constants::ZMQ_SUB_ENDPOINT;
+    } else {
+        int offset = (number - 1) * Constants::INSTRUMENT_PORT_STRIDE;
+        instrument.prefix = BASE_PREFIX + std::to_string(number);
+        instrument.router_endpoint = offset_port(Constants::ZMQ_ROUTER_ENDPOINT, offset);
+        instrument.sub_endpoint = offset_port(Constants::ZMQ_SUB_ENDPOINT, offset);
+    }
+    return instrument;
+}
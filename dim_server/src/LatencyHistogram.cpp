@@ -0,0 +1,116 @@
+#include "LatencyHistogram.h"
+
+using json = nlohmann::json;
+
+// LatencyHistogram
+// ==========================================================
+int LatencyHistogram::bucket_index(uint64_t ns) {
+    if (ns < 2 * SUB_BUCKETS) return static_cast<int>(ns);
+    int exponent = 63 - __builtin_clzll(ns);
+    if (exponent > MAX_EXPONENT) return BUCKET_COUNT - 1;
+    int shift = exponent - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKETS + static_cast<int>(ns >> shift);
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(int index) {
+    if (index < 2 * SUB_BUCKETS) return static_cast<uint64_t>(index);
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t mantissa = static_cast<uint64_t>(index - shift * SUB_BUCKETS);
+    return mantissa << shift;
+}
+
+void LatencyHistogram::record(int64_t ns) {
+    uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count.fetch_add(1, std::memory_order_relaxed);
+    total_ns.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current_max = max_ns.load(std::memory_order_relaxed);
+    while (value > current_max && !max_ns.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    total_count.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(const std::array<uint64_t, BUCKET_COUNT>& counts, uint64_t total, double fraction) const {
+    uint64_t target = static_cast<uint64_t>(fraction * total + 0.5);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            // Report the middle of the bucket rather than its edge.
+            if (i + 1 == BUCKET_COUNT) return bucket_lower_bound(i);
+            return (bucket_lower_bound(i) + bucket_lower_bound(i + 1)) / 2;
+        }
+    }
+    return bucket_lower_bound(BUCKET_COUNT - 1);
+}
+
+json LatencyHistogram::summary() const {
+    // Snapshot first so the percentiles are computed on a consistent total.
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    json j;
+    j["count"] = total;
+    if (total == 0) return j;
+    j["mean_us"] = total_ns.load(std::memory_order_relaxed) / 1e3 / total_count.load(std::memory_order_relaxed);
+    j["p50_us"] = percentile(counts, total, 0.50) / 1e3;
+    j["p90_us"] = percentile(counts, total, 0.90) / 1e3;
+    j["p99_us"] = percentile(counts, total, 0.99) / 1e3;
+    j["max_us"] = max_ns.load(std::memory_order_relaxed) / 1e3;
+    return j;
+}
+
+// LatencyTracer
+// ==========================================================
+namespace {
+    const char* STAGE_NAMES[LatencyTracer::STAGE_COUNT] = {
+        "wait_for_trigger", "curve_transfer", "python_format", "python_publish",
+        "zmq_hop", "server_decode", "dim_publish", "end_to_end"
+    };
+
+    bool stamp(const json& trace, const char* key, int64_t& out) {
+        auto it = trace.find(key);
+        if (it == trace.end() || !it->is_number()) return false;
+        out = it->get<int64_t>();
+        return true;
+    }
+}
+
+void LatencyTracer::record(const json& trace, int64_t received_ns, int64_t decoded_ns, int64_t published_ns) {
+    int64_t arm, complete, transfer_start, transfer, format, publish;
+    bool has_arm = stamp(trace, "arm", arm);
+    bool has_complete = stamp(trace, "complete", complete);
+    bool has_transfer_start = stamp(trace, "transfer_start", transfer_start);
+    bool has_transfer = stamp(trace, "transfer", transfer);
+    bool has_format = stamp(trace, "format", format);
+    bool has_publish = stamp(trace, "publish", publish);
+
+    if (has_arm && has_complete) stages[WAIT_FOR_TRIGGER].record(complete - arm);
+    if (has_transfer_start && has_transfer) stages[CURVE_TRANSFER].record(transfer - transfer_start);
+    if (has_transfer && has_format) stages[PYTHON_FORMAT].record(format - transfer);
+    if (has_format && has_publish) stages[PYTHON_PUBLISH].record(publish - format);
+    if (has_publish) stages[ZMQ_HOP].record(received_ns - publish);
+    stages[SERVER_DECODE].record(decoded_ns - received_ns);
+    stages[DIM_PUBLISH].record(published_ns - decoded_ns);
+    if (has_arm) stages[END_TO_END].record(published_ns - arm);
+}
+
+json LatencyTracer::summary() const {
+    json j;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        j[STAGE_NAMES[stage]] = stages[stage].summary();
+    }
+    return j;
+}
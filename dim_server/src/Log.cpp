@@ -0,0 +1,307 @@
+#include "Log.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+// Standard CPP libraries
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ctime>
+
+// System
+#include <pthread.h>
+
+namespace Log {
+namespace detail {
+    std::atomic<uint8_t> current_level{LEVEL_INFO};
+}
+}
+
+using namespace Log;
+using namespace Log::detail;
+
+namespace {
+    constexpr size_t RING_SLOTS = 512;          // Power of two; 128 kB per logging thread
+    constexpr int FLUSH_PERIOD_MS = 20;
+
+    const char* LEVEL_NAMES[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+    // Single producer (the owning thread), single consumer (the flusher).
+    struct Ring {
+        Record slots[RING_SLOTS];
+        alignas(64) std::atomic<uint64_t> head{0};   // Next slot to write, owned by the producer
+        alignas(64) std::atomic<uint64_t> tail{0};   // Next slot to read, owned by the flusher
+        char thread_name[16] = "?";
+    };
+
+    struct Line {
+        int64_t wall_ns;
+        Level level;
+        std::string text;
+    };
+
+    class Logger {
+    public:
+        Logger() : flusher(&Logger::flush_loop, this) {}
+
+        std::shared_ptr<Ring> register_thread() {
+            auto ring = std::make_shared<Ring>();
+            pthread_getname_np(pthread_self(), ring->thread_name, sizeof(ring->thread_name));
+            std::lock_guard<std::mutex> lock(mtx);
+            rings.push_back(ring);
+            return ring;
+        }
+
+        void set_output(FILE* new_out, FILE* new_err) {
+            std::lock_guard<std::mutex> lock(mtx);
+            out = new_out;
+            err = new_err;
+        }
+
+        void flush() {
+            std::unique_lock<std::mutex> lock(mtx);
+            uint64_t target = ++requested;
+            wakeup.notify_all();
+            done.wait(lock, [&] { return completed >= target || stopping; });
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                stopping = true;
+            }
+            wakeup.notify_all();
+            if (flusher.joinable()) flusher.join();
+        }
+
+        std::atomic<uint64_t> dropped{0};
+
+    private:
+        void flush_loop() {
+            set_current_thread_name("osc-log");
+            std::unique_lock<std::mutex> lock(mtx);
+            while (true) {
+                wakeup.wait_for(lock, std::chrono::milliseconds(FLUSH_PERIOD_MS),
+                    [this] { return stopping || requested > completed; });
+                uint64_t serving = requested;
+                bool last = stopping;
+
+                std::vector<std::shared_ptr<Ring>> snapshot = rings;
+                FILE* to_out = out;
+                FILE* to_err = err;
+                lock.unlock();
+
+                drain(snapshot, to_out, to_err);
+
+                lock.lock();
+                // Forget rings of exited threads once they are empty.
+                rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& ring) {
+                    return ring.use_count() == 1 && ring->tail.load() == ring->head.load();
+                }), rings.end());
+                completed = serving;
+                done.notify_all();
+                if (last) return;
+            }
+        }
+
+        void drain(const std::vector<std::shared_ptr<Ring>>& snapshot, FILE* to_out, FILE* to_err) {
+            OSC_TRACE_SCOPE("log/drain");
+            lines.clear();
+            for (const auto& ring : snapshot) {
+                uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                uint64_t head = ring->head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail) {
+                    const Record& r = ring->slots[tail & (RING_SLOTS - 1)];
+                    lines.push_back({r.wall_ns, r.level, format_record(r, ring->thread_name)});
+                }
+                ring->tail.store(tail, std::memory_order_release);
+            }
+            if (lines.empty()) return;
+
+            // Each ring is in order; merge them so the output reads chronologically.
+            std::stable_sort(lines.begin(), lines.end(),
+                [](const Line& a, const Line& b) { return a.wall_ns < b.wall_ns; });
+
+            bool wrote_out = false, wrote_err = false;
+            for (const Line& line : lines) {
+                FILE* stream = line.level >= LEVEL_WARN ? to_err : to_out;
+                fwrite(line.text.data(), 1, line.text.size(), stream);
+                (stream == to_err ? wrote_err : wrote_out) = true;
+            }
+            if (wrote_out) fflush(to_out);
+            if (wrote_err) fflush(to_err);
+        }
+
+        static std::string format_record(const Record& r, const char* thread_name) {
+            std::string text;
+            text.reserve(128);
+
+            char stamp[64];
+            time_t seconds = static_cast<time_t>(r.wall_ns / 1000000000);
+            struct tm local;
+            localtime_r(&seconds, &local);
+            size_t n = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local);
+            snprintf(stamp + n, sizeof(stamp) - n, ".%06lld ", static_cast<long long>(r.wall_ns % 1000000000 / 1000));
+            text += stamp;
+            text += LEVEL_NAMES[r.level < LEVEL_OFF ? r.level : LEVEL_ERROR];
+            text += " [";
+            text += thread_name;
+            text += "] ";
+
+            size_t offset = 0;
+            int remaining = r.arg_count;
+            for (const char* p = r.format; *p; ++p) {
+                if (p[0] == '{' && p[1] == '}' && remaining > 0) {
+                    append_arg(text, r, offset);
+                    --remaining;
+                    ++p;
+                } else {
+                    text += *p;
+                }
+            }
+            text += '\n';
+            return text;
+        }
+
+        static void append_arg(std::string& text, const Record& r, size_t& offset) {
+            ArgType type = static_cast<ArgType>(r.args[offset++]);
+            char number[32];
+            switch (type) {
+                case ARG_INT: {
+                    int64_t v;
+                    std::memcpy(&v, r.args + offset, sizeof(v));
+                    offset += sizeof(v);
+                    snprintf(number, sizeof(number), "%lld", static_cast<long long>(v));
+                    text += number;
+                    break;
+                }
+                case ARG_UINT: {
+                    uint64_t v;
+                    std::memcpy(&v, r.args + offset, sizeof(v));
+                    offset += sizeof(v);
+                    snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(v));
+                    text += number;
+                    break;
+                }
+                case ARG_DOUBLE: {
+                    double v;
+                    std::memcpy(&v, r.args + offset, sizeof(v));
+                    offset += sizeof(v);
+                    snprintf(number, sizeof(number), "%.6g", v);
+                    text += number;
+                    break;
+                }
+                case ARG_BOOL: {
+                    bool v;
+                    std::memcpy(&v, r.args + offset, sizeof(v));
+                    offset += sizeof(v);
+                    text += v ? "true" : "false";
+                    break;
+                }
+                case ARG_STRING: {
+                    uint16_t n;
+                    std::memcpy(&n, r.args + offset, sizeof(n));
+                    offset += sizeof(n);
+                    text.append(r.args + offset, n);
+                    offset += n;
+                    break;
+                }
+            }
+        }
+
+        std::mutex mtx;
+        std::condition_variable wakeup;
+        std::condition_variable done;
+        std::vector<std::shared_ptr<Ring>> rings;
+        std::vector<Line> lines;            // Flusher thread only
+        FILE* out = stdout;
+        FILE* err = stderr;
+        uint64_t requested = 0;
+        uint64_t completed = 0;
+        bool stopping = false;
+        std::thread flusher;                // Last: starts once everything above is constructed
+    };
+
+    // Never destroyed: DIM threads may still log while static destructors run. The flusher is stopped
+    // (and the rings drained one last time) at exit instead.
+    Logger& logger() {
+        static Logger* instance = [] {
+            Logger* created = new Logger();
+            std::atexit([] { logger().stop(); });
+            return created;
+        }();
+        return *instance;
+    }
+
+    thread_local std::shared_ptr<Ring> local_ring;
+}
+
+namespace Log {
+
+void set_level(Level level) {
+    current_level.store(level, std::memory_order_relaxed);
+}
+
+Level parse_level(const std::string& name) {
+    if (name == "debug") return LEVEL_DEBUG;
+    if (name == "warn") return LEVEL_WARN;
+    if (name == "error") return LEVEL_ERROR;
+    if (name == "off") return LEVEL_OFF;
+    return LEVEL_INFO;
+}
+
+void set_output(FILE* out, FILE* err) {
+    logger().set_output(out, err);
+}
+
+void flush() {
+    logger().flush();
+}
+
+uint64_t dropped() {
+    return logger().dropped.load(std::memory_order_relaxed);
+}
+
+bool RateLimit::allow(uint64_t& suppressed) {
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t current = window.load(std::memory_order_relaxed);
+    if (now != current && window.compare_exchange_strong(current, now, std::memory_order_relaxed)) {
+        count.store(0, std::memory_order_relaxed);
+        suppressed = dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+namespace detail {
+
+Record* claim() {
+    if (!local_ring) local_ring = logger().register_thread();
+    Ring& ring = *local_ring;
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+        logger().dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring.slots[head & (RING_SLOTS - 1)];
+}
+
+void publish() {
+    Ring& ring = *local_ring;
+    ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int64_t wall_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
+}
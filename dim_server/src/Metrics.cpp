@@ -0,0 +1,191 @@
+#include "Metrics.h"
+#include "Constants.h"
+
+// Standard CPP libraries
+#include <fstream>
+#include <sstream>
+
+// System
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+void set_current_thread_name(const char* name) {
+    pthread_setname_np(pthread_self(), name);
+}
+
+namespace {
+    const char* COUNTER_NAMES[Metrics::COUNTER_COUNT] = {
+        "commands_sent", "replies_ok", "replies_error",
+        "not_connected", "malformed_json", "bad_topic", "reply_expired", "queue_full", "frame_dropped", "unknown_client",
+        "backend_lost", "commands_failed", "failovers", "settings_answered"
+    };
+
+    const char* TOPIC_NAMES[Metrics::TOPIC_COUNT] = {
+        "backend_state", "waveform_timediv", "backend_timing", "sequence_progress",
+        "waveform_ch1", "waveform_ch2", "waveform_ch3", "waveform_ch4", "other"
+    };
+
+    std::atomic<uint64_t> next_instance_id{1};
+
+    // Each thread remembers its block of every Metrics, so the common case is a single compare even
+    // on threads all instruments share (DIM). Instances are numbered in order, so up to
+    // MAX_INSTRUMENTS of them never evict each other.
+    struct BlockCache {
+        uint64_t instance_id = 0;
+        void* block = nullptr;
+    };
+    thread_local BlockCache block_cache[Constants::MAX_INSTRUMENTS];
+
+    // Resident set size in kB from /proc/self/status, 0 if unavailable.
+    uint64_t resident_kb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmRSS:", 0) == 0) {
+                return std::stoull(line.substr(6));
+            }
+        }
+        return 0;
+    }
+}
+
+Metrics::Metrics() :
+    instance_id(next_instance_id.fetch_add(1)),
+    start_time(std::chrono::steady_clock::now()),
+    last_snapshot(start_time)
+{
+}
+
+Metrics::ThreadBlock& Metrics::local_block() {
+    BlockCache& cached = block_cache[instance_id % Constants::MAX_INSTRUMENTS];
+    if (cached.instance_id == instance_id) {
+        return *static_cast<ThreadBlock*>(cached.block);
+    }
+    std::lock_guard<std::mutex> lock(blocks_mutex);
+    auto& block = blocks[std::this_thread::get_id()];
+    if (!block) block = std::make_unique<ThreadBlock>();
+    cached.instance_id = instance_id;
+    cached.block = block.get();
+    return *block;
+}
+
+void Metrics::add(Counter counter, uint64_t n) {
+    local_block().counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void Metrics::add_message(Topic topic, uint64_t bytes) {
+    ThreadBlock& block = local_block();
+    block.messages[topic].fetch_add(1, std::memory_order_relaxed);
+    block.bytes[topic].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+Metrics::Totals Metrics::sum_blocks() {
+    Totals totals;
+    std::lock_guard<std::mutex> lock(blocks_mutex);
+    for (const auto& entry : blocks) {
+        const ThreadBlock& block = *entry.second;
+        for (int i = 0; i < COUNTER_COUNT; ++i) totals.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < TOPIC_COUNT; ++i) {
+            totals.messages[i] += block.messages[i].load(std::memory_order_relaxed);
+            totals.bytes[i] += block.bytes[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+json Metrics::thread_cpu(double elapsed_s) {
+    json threads = json::array();
+    static const double ticks_per_s = static_cast<double>(sysconf(_SC_CLK_TCK));
+
+    std::map<int, uint64_t> thread_ticks;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return threads;
+
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        int tid = std::atoi(entry->d_name);
+        std::string base = std::string("/proc/self/task/") + entry->d_name;
+
+        std::string name;
+        std::ifstream comm(base + "/comm");
+        std::getline(comm, name);
+
+        // utime and stime are fields 14 and 15; the name in field 2 may contain spaces, so skip past its ')'.
+        std::ifstream stat_file(base + "/stat");
+        std::string stat;
+        std::getline(stat_file, stat);
+        size_t close = stat.rfind(')');
+        if (close == std::string::npos) continue;
+        std::istringstream fields(stat.substr(close + 2));
+        std::string skip;
+        for (int field = 3; field < 14; ++field) fields >> skip;
+        uint64_t utime = 0, stime = 0;
+        fields >> utime >> stime;
+
+        uint64_t ticks = utime + stime;
+        thread_ticks[tid] = ticks;
+
+        auto previous = last_thread_ticks.find(tid);
+        uint64_t delta = previous == last_thread_ticks.end() ? 0 : ticks - previous->second;
+        threads.push_back({
+            {"tid", tid},
+            {"name", name},
+            {"cpu_pct", elapsed_s > 0 ? 100.0 * delta / ticks_per_s / elapsed_s : 0.0},
+            {"cpu_total_s", ticks / ticks_per_s}
+        });
+    }
+    closedir(dir);
+
+    last_thread_ticks = std::move(thread_ticks);
+    return threads;
+}
+
+json Metrics::snapshot(const json& reply_latency) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed_s = std::chrono::duration<double>(now - last_snapshot).count();
+    Totals totals = sum_blocks();
+
+    auto rate = [elapsed_s](uint64_t current, uint64_t previous) {
+        return elapsed_s > 0 ? (current - previous) / elapsed_s : 0.0;
+    };
+
+    json j;
+    j["uptime_s"] = std::chrono::duration<double>(now - start_time).count();
+
+    json topics;
+    for (int i = 0; i < TOPIC_COUNT; ++i) {
+        topics[TOPIC_NAMES[i]] = {
+            {"msgs_per_s", rate(totals.messages[i], last_totals.messages[i])},
+            {"bytes_per_s", rate(totals.bytes[i], last_totals.bytes[i])},
+            {"msgs_total", totals.messages[i]}
+        };
+    }
+    j["topics"] = topics;
+
+    j["commands"] = {
+        {"per_s", rate(totals.counters[COMMANDS_SENT], last_totals.counters[COMMANDS_SENT])},
+        {"total", totals.counters[COMMANDS_SENT]},
+        {"pending", pending_commands.load(std::memory_order_relaxed)},
+        {"reply_latency", reply_latency}
+    };
+
+    json counters;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (i == COMMANDS_SENT) continue;
+        counters[COUNTER_NAMES[i]] = totals.counters[i];
+    }
+    j["counters"] = counters;
+
+    j["memory"] = {
+        {"service_buffers_bytes", buffer_bytes.load(std::memory_order_relaxed)},
+        {"rss_kb", resident_kb()}
+    };
+    j["threads"] = thread_cpu(elapsed_s);
+
+    last_totals = totals;
+    last_snapshot = now;
+    return j;
+}
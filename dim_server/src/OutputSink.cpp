@@ -0,0 +1,52 @@
+#include "OutputSink.h"
+#include <cstring>
+#include <algorithm>
+
+CountingSink::CountingSink(std::string name, size_t buffer_size) :
+    sink_name(std::move(name)),
+    buffer(std::max<size_t>(buffer_size, 1), '\0')
+{
+}
+
+void CountingSink::update(const std::string& new_data) {
+    std::lock_guard<std::mutex> lock(mtx);
+    length = std::min(new_data.size(), buffer.size() - 1);
+    memcpy(buffer.data(), new_data.data(), length);
+    buffer[length] = '\0';
+    update_count.fetch_add(1, std::memory_order_relaxed);
+    byte_count.fetch_add(length, std::memory_order_relaxed);
+}
+
+std::string CountingSink::last() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return std::string(buffer.data(), length);
+}
+
+std::unique_ptr<OutputSink> CountingSinkFactory::create(const std::string& name, size_t buffer_size) {
+    auto sink = std::make_unique<CountingSink>(name, buffer_size);
+    std::lock_guard<std::mutex> lock(mtx);
+    sinks.push_back(sink.get());
+    return sink;
+}
+
+CountingSink* CountingSinkFactory::find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (CountingSink* sink : sinks) {
+        if (sink->name() == name) return sink;
+    }
+    return nullptr;
+}
+
+uint64_t CountingSinkFactory::total_updates() {
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t total = 0;
+    for (CountingSink* sink : sinks) total += sink->updates();
+    return total;
+}
+
+uint64_t CountingSinkFactory::total_bytes() {
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t total = 0;
+    for (CountingSink* sink : sinks) total += sink->bytes();
+    return total;
+}
@@ -0,0 +1,214 @@
+#include "SettingsMirror.h"
+#include "Constants.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    // A mirrored query: its header in SCPI form (upper case = short form), '#' for the channel digit,
+    // and where the value is kept.
+    struct MirroredQuery {
+        const char* header;
+        const char* group;
+        const char* key;
+    };
+    const MirroredQuery QUERIES[] = {
+        {"CH#:SCAle", "channels", "scale"},
+        {"SELect:CH#", "channels", "enabled"},
+        {"HORizontal:MAIn:SCAle", "horizontal", "scale"},
+        {"HORizontal:SCAle", "horizontal", "scale"},
+        {"TRIGger:A:EDGe:SOUrce", "trigger", "source"},
+        {"TRIGger:A:EDGe:SLOpe", "trigger", "slope"},
+        {"TRIGger:A:LEVel", "trigger", "level"},
+        {"ACQuire:MODe", "acquisition", "mode"},
+        {"ACQuire:NUMAVg", "acquisition", "numavg"},
+        {"ACQuire:NUMEnv", "acquisition", "numenv"},
+    };
+
+    std::string upper(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::toupper(c); });
+        return text;
+    }
+
+    std::vector<std::string> split(const std::string& text, char separator) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        for (size_t end; (end = text.find(separator, start)) != std::string::npos; start = end + 1) {
+            parts.push_back(text.substr(start, end - start));
+        }
+        parts.push_back(text.substr(start));
+        return parts;
+    }
+
+    // A query keyword against a pattern keyword: the short or the long form; "CH#" takes CH1..CH4.
+    bool keyword_matches(const std::string& pattern, const std::string& keyword, int& channel) {
+        if (!pattern.empty() && pattern.back() == '#') {
+            std::string prefix = pattern.substr(0, pattern.size() - 1);
+            if (keyword.size() != prefix.size() + 1 || keyword.compare(0, prefix.size(), prefix) != 0) return false;
+            channel = keyword.back() - '0';
+            return channel >= 1 && channel <= Constants::OSC_NUM_CHANNELS;
+        }
+        size_t short_length = 0;
+        while (short_length < pattern.size() && !std::islower(static_cast<unsigned char>(pattern[short_length]))) ++short_length;
+        return keyword == pattern.substr(0, short_length) || keyword == upper(pattern);
+    }
+
+    // Copies the keys of 'target' that 'source' has.
+    void merge_known(json& target, const json& source) {
+        if (!source.is_object()) return;
+        for (auto& item : target.items()) {
+            auto it = source.find(item.key());
+            if (it == source.end()) continue;
+            if (item.value().is_object()) merge_known(item.value(), *it);
+            else item.value() = *it;
+        }
+    }
+}
+
+SettingsMirror::SettingsMirror() : settings(unknown()), answers(unknown()) {}
+
+json SettingsMirror::unknown() {
+    json channels = json::object();
+    for (int ch = 1; ch <= Constants::OSC_NUM_CHANNELS; ++ch) channels[std::to_string(ch)] = {{"enabled", nullptr}, {"scale", nullptr}};
+    return {
+        {"channels", channels},
+        {"horizontal", {{"scale", nullptr}}},
+        {"trigger", {{"source", nullptr}, {"slope", nullptr}, {"level", nullptr}}},
+        {"acquisition", {{"mode", nullptr}, {"numavg", nullptr}, {"numenv", nullptr}}},
+    };
+}
+
+void SettingsMirror::sent(const json& request) {
+    static const char* CHANGING[] = {
+        Constants::PY_SET_CHAN_ENABLED, Constants::PY_SET_CHAN_SCALE, Constants::PY_SET_TRIG_CHANNEL,
+        Constants::PY_SET_TRIG_SLOPE, Constants::PY_SET_TRIG_LEVEL, Constants::PY_SET_ACQ_TIMEDIV,
+        Constants::PY_SET_ACQ_SAMPLING, Constants::PY_RUN_SEQUENCE, Constants::PY_RECALL_SETUP, Constants::PY_RAW_WRITE
+    };
+    if (!request.is_object()) return;
+    std::string command = request.value(Constants::JSON_COMMAND, "");
+    if (std::none_of(std::begin(CHANGING), std::end(CHANGING), [&command](const char* name) { return command == name; })) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string id = request.value(Constants::JSON_ID, "");
+    if (id.empty()) {
+        // Its reply cannot be told apart: give up what it may change.
+        settings = unknown();
+        answers = unknown();
+        return;
+    }
+    pending[id] = request;
+}
+
+bool SettingsMirror::replied(const std::string& id, bool ok) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pending.find(id);
+    if (it == pending.end()) return false;
+    json request = std::move(it->second);
+    pending.erase(it);
+    std::string command = request.value(Constants::JSON_COMMAND, "");
+    if (ok) {
+        apply(request);
+    } else if (command == Constants::PY_RAW_WRITE || command == Constants::PY_RECALL_SETUP || command == Constants::PY_RUN_SEQUENCE) {
+        // May have failed halfway.
+        settings = unknown();
+        answers = unknown();
+    } else {
+        return false;   // A rejected setting leaves the scope as it was
+    }
+    return true;
+}
+
+bool SettingsMirror::lost(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.erase(id) == 0) return false;
+    settings = unknown();
+    answers = unknown();
+    return true;
+}
+
+void SettingsMirror::readback(const json& readback_settings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    settings = unknown();
+    merge_known(settings, readback_settings);
+    answers = unknown();
+    if (readback_settings.is_object()) merge_known(answers, readback_settings.value("answers", json::object()));
+    ++readbacks;
+}
+
+void SettingsMirror::apply(const json& request) {
+    std::string command = request.value(Constants::JSON_COMMAND, "");
+    const json params = request.value(Constants::JSON_PARAMS, json::object());
+    // The value is known from the command, the scope's answer only from the next readback.
+    auto patch = [this](const json::json_pointer& where, json value) {
+        settings[where] = std::move(value);
+        answers[where] = nullptr;
+    };
+    auto channel = [&params](const char* key) {
+        return json::json_pointer("/channels/" + std::to_string(params.at(Constants::JSON_CHANNEL).get<int>()) + "/" + key);
+    };
+    try {
+        if (command == Constants::PY_SET_CHAN_ENABLED) {
+            patch(channel("enabled"), params.at("enabled").get<bool>());
+        } else if (command == Constants::PY_SET_CHAN_SCALE) {
+            patch(channel("scale"), params.at("scale").get<double>());
+        } else if (command == Constants::PY_SET_TRIG_CHANNEL) {
+            patch("/trigger/source"_json_pointer, "CH" + std::to_string(params.at("channel").get<int>()));
+        } else if (command == Constants::PY_SET_TRIG_SLOPE) {
+            patch("/trigger/slope"_json_pointer, upper(params.at("slope").get<std::string>()));
+        } else if (command == Constants::PY_SET_TRIG_LEVEL) {
+            patch("/trigger/level"_json_pointer, params.at("level").get<double>());
+        } else if (command == Constants::PY_SET_ACQ_TIMEDIV) {
+            patch("/horizontal/scale"_json_pointer, params.at("level").get<double>());
+        } else if (command == Constants::PY_SET_ACQ_SAMPLING) {
+            std::string mode = upper(params.at("mode").get<std::string>());
+            patch("/acquisition/mode"_json_pointer, mode);
+            // The backend's default count is 16.
+            if (mode == "AVERAGE") patch("/acquisition/numavg"_json_pointer, params.value("count", 16));
+            if (mode == "ENVELOPE") patch("/acquisition/numenv"_json_pointer, params.value("count", 16));
+        } else {
+            // raw_write, recall_setup, run_sequence: the readback after them tells.
+            settings = unknown();
+            answers = unknown();
+        }
+    } catch (const json::exception&) {
+        settings = unknown();
+        answers = unknown();
+    }
+}
+
+std::string SettingsMirror::answer(const std::string& query) {
+    // A single query: "CH1:SCAle?", ":TRIG:A:LEV?" -- no arguments, no compound commands.
+    std::string text = upper(query);
+    text.erase(0, text.find_first_not_of(" \t"));
+    text.erase(text.find_last_not_of(" \t\r\n") + 1);
+    if (!text.empty() && text.front() == ':') text.erase(0, 1);
+    if (text.size() < 2 || text.back() != '?' || text.find_first_of("; \t?") != text.size() - 1) return "";
+    std::vector<std::string> keywords = split(text.substr(0, text.size() - 1), ':');
+
+    for (const MirroredQuery& mirrored : QUERIES) {
+        std::vector<std::string> pattern = split(mirrored.header, ':');
+        if (pattern.size() != keywords.size()) continue;
+        int channel = 0;
+        bool matches = true;
+        for (size_t i = 0; i < pattern.size() && matches; ++i) matches = keyword_matches(pattern[i], keywords[i], channel);
+        if (!matches) continue;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pending.empty()) return "";
+        const json& group = answers[mirrored.group];
+        const json& value = channel ? group[std::to_string(channel)][mirrored.key] : group[mirrored.key];
+        return value.is_string() ? value.get<std::string>() : "";
+    }
+    return "";
+}
+
+json SettingsMirror::snapshot() {
+    std::lock_guard<std::mutex> lock(mutex);
+    json j = settings;
+    j["readbacks"] = readbacks;
+    j["changes_pending"] = pending.size();
+    return j;
+}
@@ -0,0 +1,60 @@
+#include "TaskGraph.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
+
+TaskGraph::TaskGraph(TaskPool& task_pool) : pool(task_pool) {}
+
+TaskGraph::Id TaskGraph::add(std::string name, std::function<void()> fn, std::initializer_list<Id> after) {
+    Id id = nodes.size();
+    Node& node = nodes.emplace_back();
+    node.name = std::move(name);
+    node.fn = std::move(fn);
+    for (Id dependency : after) {
+        nodes.at(dependency).dependents.push_back(id);
+        ++node.remaining;
+    }
+    return id;
+}
+
+void TaskGraph::run() {
+    if (nodes.empty()) return;
+    OSC_TRACE_SCOPE("analysis/barrier");
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        unfinished = nodes.size();
+    }
+    // Collected first: with an inline pool a root can finish, and release others, before the scan ends.
+    std::vector<Id> roots;
+    for (Id id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].remaining.load() == 0) roots.push_back(id);
+    }
+    for (Id id : roots) pool.submit([this, id] { execute(id); });
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [this] { return unfinished == 0; });
+    if (error) std::rethrow_exception(error);
+}
+
+void TaskGraph::execute(Id id) {
+    Node& node = nodes[id];
+    std::exception_ptr failure;
+    {
+        OSC_TRACE_SCOPE("analysis/task");
+        int64_t start_ns = monotonic_ns();
+        try {
+            node.fn();
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        pool.timing(node.name).record(monotonic_ns() - start_ns);
+    }
+
+    for (Id dependent : node.dependents) {
+        if (nodes[dependent].remaining.fetch_sub(1) == 1) pool.submit([this, dependent] { execute(dependent); });
+    }
+
+    // Last: once 'unfinished' reaches zero run() returns and the graph may be destroyed.
+    std::lock_guard<std::mutex> lock(done_mutex);
+    if (failure && !error) error = failure;
+    if (--unfinished == 0) done.notify_all();
+}
@@ -0,0 +1,120 @@
+#include "TaskPool.h"
+#include "Metrics.h"
+
+using json = nlohmann::json;
+
+namespace {
+    // Lets a task submit to the deque of the worker running it.
+    thread_local const TaskPool* current_pool = nullptr;
+    thread_local size_t current_index = 0;
+}
+
+TaskPool::TaskPool(size_t worker_count) {
+    for (size_t i = 0; i < worker_count; ++i) workers.push_back(std::make_unique<Worker>());
+}
+
+TaskPool::~TaskPool() {
+    stop();
+}
+
+void TaskPool::start() {
+    running = true;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread = std::thread(&TaskPool::run, this, i);
+    }
+}
+
+void TaskPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        running = false;
+    }
+    idle.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+void TaskPool::submit(Task task) {
+    if (workers.empty()) {
+        task();
+        executed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    size_t index = current_pool == this ? current_index
+                                        : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mtx);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Raised under the lock, so a worker checking 'pending' before it sleeps cannot miss it.
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        pending.fetch_add(1);
+    }
+    idle.notify_one();
+}
+
+bool TaskPool::take(size_t index, Task& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending.fetch_sub(1);
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskPool::run(size_t index) {
+    set_current_thread_name(("osc-analysis" + std::to_string(index + 1)).c_str());
+    current_pool = this;
+    current_index = index;
+    Task task;
+    while (true) {
+        while (take(index, task)) {
+            task();
+            task = nullptr;
+            executed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle.wait(lock, [this] { return pending.load() > 0 || !running; });
+        if (!running && pending.load() == 0) return;
+    }
+}
+
+LatencyHistogram& TaskPool::timing(const std::string& name) {
+    std::lock_guard<std::mutex> lock(timings_mutex);
+    auto& histogram = timings[name];
+    if (!histogram) histogram = std::make_unique<LatencyHistogram>();
+    return *histogram;
+}
+
+json TaskPool::status() const {
+    json tasks = json::object();
+    {
+        std::lock_guard<std::mutex> lock(timings_mutex);
+        for (const auto& [name, histogram] : timings) tasks[name] = histogram->summary();
+    }
+    return {
+        {"workers", workers.size()},
+        {"executed", executed.load(std::memory_order_relaxed)},
+        {"stolen", stolen.load(std::memory_order_relaxed)},
+        {"tasks", tasks}
+    };
+}
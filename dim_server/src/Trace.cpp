@@ -0,0 +1,164 @@
+#include "Trace.h"
+#include "LatencyHistogram.h"
+#include "Log.h"
+
+// Standard CPP libraries
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// System
+#include <csignal>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Trace {
+    std::atomic<bool> active{false};
+}
+
+namespace {
+    // Fields are relaxed atomics so a dump can read them while the owner keeps writing.
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t> start_ns{0};
+        std::atomic<int64_t> end_ns{0};
+        std::atomic<int64_t> value{0};
+    };
+
+    struct ThreadEvents {
+        Event events[Trace::EVENTS_PER_THREAD];
+        std::atomic<uint64_t> written{0};
+        long tid = 0;
+        char thread_name[16] = "?";
+    };
+
+    // Slots the owner may be overwriting while a dump reads the ring.
+    constexpr uint64_t DUMP_MARGIN = 64;
+
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<ThreadEvents>> registry;
+    thread_local std::shared_ptr<ThreadEvents> local_events;
+    thread_local ThreadEvents* local_raw = nullptr;   // Trivial TLS, cheaper to reach than the shared_ptr
+
+    std::atomic<bool> signal_pending{false};
+    std::atomic<int> dump_counter{0};
+
+    ThreadEvents& thread_events() {
+        if (local_raw) return *local_raw;
+        if (!local_events) {
+            local_events = std::make_shared<ThreadEvents>();
+            local_events->tid = static_cast<long>(syscall(SYS_gettid));
+            pthread_getname_np(pthread_self(), local_events->thread_name, sizeof(local_events->thread_name));
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            registry.push_back(local_events);
+        }
+        local_raw = local_events.get();
+        return *local_raw;
+    }
+
+    void on_sigusr1(int) {
+        signal_pending.store(true, std::memory_order_relaxed);
+    }
+
+    // Thread names come from pthread_setname_np and need no escaping beyond quotes and backslashes.
+    std::string escape(const char* s) {
+        std::string out;
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\') out += '\\';
+            if (static_cast<unsigned char>(*s) >= 0x20) out += *s;
+        }
+        return out;
+    }
+}
+
+namespace Trace {
+
+void set_enabled(bool enabled) {
+    active.store(enabled, std::memory_order_relaxed);
+    LOG_INFO("Tracing {}", enabled ? "enabled" : "disabled");
+}
+
+int64_t Scope::now_ns() {
+    return monotonic_ns();
+}
+
+void record(const char* name, int64_t start_ns, int64_t end_ns, int64_t value) {
+    ThreadEvents& events = thread_events();
+    uint64_t index = events.written.load(std::memory_order_relaxed);
+    Event& event = events.events[index & (EVENTS_PER_THREAD - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.end_ns.store(end_ns, std::memory_order_relaxed);
+    event.value.store(value, std::memory_order_relaxed);
+    events.written.store(index + 1, std::memory_order_release);
+}
+
+long dump(const std::string& path) {
+    std::vector<std::shared_ptr<ThreadEvents>> threads;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        threads = registry;
+    }
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        LOG_ERROR("Cannot open trace file '{}'", path);
+        return -1;
+    }
+
+    const long pid = static_cast<long>(getpid());
+    long count = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"args\":{\"name\":\"osc_dim_server\"}}", pid);
+
+    for (const auto& thread : threads) {
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+            pid, thread->tid, escape(thread->thread_name).c_str());
+
+        uint64_t written = thread->written.load(std::memory_order_acquire);
+        uint64_t first = 0;
+        if (written > EVENTS_PER_THREAD - DUMP_MARGIN) first = written - (EVENTS_PER_THREAD - DUMP_MARGIN);
+
+        for (uint64_t i = first; i < written; ++i) {
+            const Event& event = thread->events[i & (EVENTS_PER_THREAD - 1)];
+            const char* name = event.name.load(std::memory_order_relaxed);
+            int64_t start = event.start_ns.load(std::memory_order_relaxed);
+            int64_t end = event.end_ns.load(std::memory_order_relaxed);
+            int64_t value = event.value.load(std::memory_order_relaxed);
+            if (!name || end < start) continue;
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f",
+                name, pid, thread->tid, start / 1e3, (end - start) / 1e3);
+            if (value != NO_VALUE) fprintf(file, ",\"args\":{\"value\":%lld}", static_cast<long long>(value));
+            fprintf(file, "}");
+            ++count;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    LOG_INFO("Wrote {} trace events from {} threads to {}", count, threads.size(), path);
+    return count;
+}
+
+std::string default_path() {
+    return "/tmp/osc_dim_trace_" + std::to_string(getpid()) + "_" + std::to_string(dump_counter++) + ".json";
+}
+
+void install_signal_handler() {
+    struct sigaction action {};
+    action.sa_handler = on_sigusr1;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+void service_signal() {
+    if (signal_pending.exchange(false, std::memory_order_relaxed)) {
+        dump(default_path());
+    }
+}
+
+}
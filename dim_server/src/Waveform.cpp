@@ -0,0 +1,44 @@
+#include "Waveform.h"
+#include "Trace.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace Waveform {
+
+void format(const double* samples, size_t count, std::string& out) {
+    OSC_TRACE_SCOPE_VALUE("waveform/format", count);
+    out.clear();
+    out.reserve(count * (MAX_SAMPLE_CHARS + 1));
+
+    char field[32];
+    for (size_t i = 0; i < count; ++i) {
+        int len = std::snprintf(field, sizeof(field), "%.6E", samples[i]);
+        if (i != 0) out.push_back(',');
+        out.append(field, static_cast<size_t>(len));
+    }
+}
+
+bool parse(const std::string& payload, std::vector<double>& out) {
+    OSC_TRACE_SCOPE_VALUE("waveform/parse", payload.size());
+    out.clear();
+    if (payload.empty()) return true;
+    out.reserve(payload.size() / (MAX_SAMPLE_CHARS + 1) + 1);
+
+    const char* cursor = payload.c_str();
+    const char* end = cursor + payload.size();
+    while (cursor < end) {
+        char* field_end = nullptr;
+        double value = std::strtod(cursor, &field_end);
+        if (field_end == cursor) return false;
+        out.push_back(value);
+
+        cursor = field_end;
+        if (cursor < end) {
+            if (*cursor != ',') return false;
+            ++cursor;
+        }
+    }
+    return true;
+}
+
+}
@@ -1,11 +1,16 @@
 #include "ZMQCommunicator.h"
-#include "DimServices.h"
 #include "Constants.h"
+#include "Log.h"
+#include "Trace.h"
+#include "Waveform.h"
+#include "TaskGraph.h"
 
 // Standard CPP libraries
-#include <iostream>
 #include <chrono>
+#include <cstdlib>
 #include <memory>
+#include <algorithm>
+#include <iterator>
 
 // Outside dependencies
 #include <zmq_addon.hpp>
@@ -13,20 +18,47 @@
 
 using json = nlohmann::json;
 
-ZmqCommunicator::ZmqCommunicator(ReplyService& service) :
+ZmqCommunicator::ZmqCommunicator(OutputSink& reply, SinkFactory& sinks, const Instrument& served, size_t analysis_threads) :
+    instrument(served),
     context(1),
     running(false),
     router_socket(context, zmq::socket_type::router),
     sub_socket(context, zmq::socket_type::sub),
-    reply_svc(service),
-    state_svc(Constants::STATE_SERVICE, Constants::STATE_BUFFER_SIZE),
-    timediv_svc(Constants::TIMEDIV_SERVICE, Constants::STATE_BUFFER_SIZE)
+    wake_receive(context, zmq::socket_type::pair),
+    wake_send(context, zmq::socket_type::pair),
+    reply_svc(reply),
+    state_svc(sinks.create(service_name(Constants::STATE_SERVICE), Constants::STATE_BUFFER_SIZE)),
+    timediv_svc(sinks.create(service_name(Constants::TIMEDIV_SERVICE), Constants::STATE_BUFFER_SIZE)),
+    duty_cycle(static_cast<int64_t>(Constants::BACKEND_TIMING_WINDOW_S) * 1000000000),
+    analysis_pool(analysis_threads),
+    credit_epoch(monotonic_ns())
 {
     // Create and store the 4 waveform services
     for (int i = 0; i < Constants::OSC_NUM_CHANNELS; ++i) {
-        std::string service_name = Constants::WAVEFORM_SERVICE_BASE + std::to_string(i + 1);
-        waveform_svcs.push_back(std::make_unique<ProtectedDimService>(service_name, Constants::WAVEFORM_BUFFER_SIZE));
+        std::string channel_service = service_name(Constants::WAVEFORM_SERVICE_BASE) + std::to_string(i + 1);
+        waveform_svcs.push_back(sinks.create(channel_service, Constants::WAVEFORM_BUFFER_SIZE));
+        meta_svcs.push_back(sinks.create(channel_service + Constants::WAVEFORM_META_SUFFIX, Constants::META_BUFFER_SIZE));
+        channel_sinks.push_back({waveform_svcs.back().get(), meta_svcs.back().get()});
+        // A published waveform returns its credit, so the backend can send the next one.
+        publishers.push_back(std::make_unique<FramePublisher>("osc-pub-ch" + std::to_string(i + 1), Constants::CHANNEL_QUEUE_FRAMES,
+            [this](Frame& frame) { dispatch(frame); return_credit(); }));
     }
+    publishers.push_back(std::make_unique<FramePublisher>("osc-pub-other", Constants::OTHER_QUEUE_FRAMES,
+        [this](Frame& frame) { dispatch(frame); }));
+    range_samples.resize(Constants::OSC_NUM_CHANNELS);
+    latency_svc = sinks.create(service_name(Constants::LATENCY_SERVICE), Constants::LATENCY_BUFFER_SIZE);
+    metrics_svc = sinks.create(service_name(Constants::METRICS_SERVICE), Constants::METRICS_BUFFER_SIZE);
+    timing_svc = sinks.create(service_name(Constants::BACKEND_TIMING_SERVICE), Constants::BACKEND_TIMING_BUFFER_SIZE);
+    sequence_svc = sinks.create(service_name(Constants::SEQUENCE_PROGRESS_SERVICE), Constants::STATE_BUFFER_SIZE);
+    auto_range_svc = sinks.create(service_name(Constants::AUTO_RANGE_SERVICE), Constants::AUTO_RANGE_BUFFER_SIZE);
+    setup_slots_svc = sinks.create(service_name(Constants::SETUP_SLOTS_SERVICE), Constants::SETUP_SLOTS_BUFFER_SIZE);
+    settings_svc = sinks.create(service_name(Constants::SETTINGS_SERVICE), Constants::SETTINGS_BUFFER_SIZE);
+    publish_settings();
+
+    metrics.set_buffer_bytes(3 * static_cast<uint64_t>(Constants::STATE_BUFFER_SIZE)
+        + static_cast<uint64_t>(Constants::OSC_NUM_CHANNELS) * (Constants::WAVEFORM_BUFFER_SIZE + Constants::META_BUFFER_SIZE)
+        + Constants::LATENCY_BUFFER_SIZE + Constants::METRICS_BUFFER_SIZE + Constants::BACKEND_TIMING_BUFFER_SIZE
+        + Constants::AUTO_RANGE_BUFFER_SIZE + Constants::SETUP_SLOTS_BUFFER_SIZE + Constants::SETTINGS_BUFFER_SIZE);
 }
 
 ZmqCommunicator::~ZmqCommunicator() {
@@ -35,103 +67,673 @@ ZmqCommunicator::~ZmqCommunicator() {
 
 void ZmqCommunicator::start(const std::string& router_endpoint, const std::string& sub_endpoint) {
     router_socket.bind(router_endpoint);
+    // inproc: bound before the connect; the context is this instrument's own.
+    wake_receive.bind("inproc://router-wake");
+    wake_send.connect("inproc://router-wake");
+    sub_socket.set(zmq::sockopt::rcvhwm, Constants::ZMQ_SUB_HWM);
     sub_socket.connect(sub_endpoint);
+    default_sub_endpoint = sub_endpoint;
+    sub_endpoints.insert(sub_endpoint);
 
     sub_socket.set(zmq::sockopt::subscribe, Constants::ZMQ_STATE_TOPIC);
     sub_socket.set(zmq::sockopt::subscribe, Constants::ZMQ_TIMEDIV_TOPIC);
+    sub_socket.set(zmq::sockopt::subscribe, Constants::ZMQ_TIMING_TOPIC);
+    sub_socket.set(zmq::sockopt::subscribe, Constants::ZMQ_SEQUENCE_TOPIC);
+    sub_socket.set(zmq::sockopt::subscribe, Constants::ZMQ_SETUP_SLOTS_TOPIC);
 
     // Subscribe to each of the 4 new waveform topics
     for (int i = 0; i < Constants::OSC_NUM_CHANNELS; ++i) {
         std::string topic_name = Constants::ZMQ_WAVEFORM_TOPIC_BASE + std::to_string(i + 1);
         sub_socket.set(zmq::sockopt::subscribe, topic_name);
-        std::cout << "Subscribed to ZMQ topic: " << topic_name << std::endl;
+        LOG_INFO("Subscribed to ZMQ topic: {}", topic_name);
     }
 
     running = true;
+    analysis_pool.start();
+    for (auto& publisher : publishers) publisher->start();
     router_thread = std::thread(&ZmqCommunicator::router_loop, this);
     sub_thread = std::thread(&ZmqCommunicator::subscribe_loop, this);
-    std::cout << "ZMQ ROUTER listening on " << router_endpoint << std::endl;
-    std::cout << "ZMQ SUB connected to " << sub_endpoint << std::endl;
+    metrics_thread = std::thread(&ZmqCommunicator::metrics_loop, this);
+    LOG_INFO("ZMQ ROUTER listening on {}", router_endpoint);
+    LOG_INFO("ZMQ SUB connected to {}", sub_endpoint);
 }
 
 void ZmqCommunicator::stop() {
     if (running) {
-        running = false;
+        {
+            std::lock_guard<std::mutex> lock(metrics_mutex);
+            running = false;
+        }
+        metrics_wakeup.notify_all();
         if (router_thread.joinable()) router_thread.join();
         if (sub_thread.joinable()) sub_thread.join();
+        if (metrics_thread.joinable()) metrics_thread.join();
+        // After the subscribe thread: nothing is offered to them anymore.
+        for (auto& publisher : publishers) publisher->stop();
+        analysis_pool.stop();
     }
 }
 
 void ZmqCommunicator::send_command(const std::string& json_str) {
-    std::lock_guard<std::mutex> lock(client_id_mutex);
-    if (python_client_id.size() == 0) {
-        reply_svc.update("Error: Python client not connected.");
+    OSC_TRACE_SCOPE("command/send");
+    if (!client_connected) {
+        metrics.add(Metrics::ERR_NOT_CONNECTED);
+        reply_svc.update(active_lost ? "Error: Python backend not responding (no heartbeat)." : "Error: Python client not connected.");
         return;
     }
-    std::cout << "Sending command to Python: " << json_str << std::endl;
-    router_socket.send(python_client_id, zmq::send_flags::sndmore);
-    router_socket.send(zmq::buffer(""), zmq::send_flags::sndmore);
-    router_socket.send(zmq::buffer(json_str), zmq::send_flags::none);
+    LOG_INFO("Sending command to Python: {}", json_str);
+    json request = json::parse(json_str, nullptr, false);
+    std::string id = request.is_object() ? request.value(Constants::JSON_ID, "") : "";
+    // Before the ROUTER thread can send it, like the pending count.
+    settings_mirror.sent(request);
+    if (!enqueue(json_str, command_priority(request), id, true)) {
+        if (settings_mirror.replied(id, false)) publish_settings();
+        metrics.add(Metrics::ERR_QUEUE_FULL);
+        reply_svc.update("Error: Too many commands waiting to be sent to Python.");
+    }
+}
+
+bool ZmqCommunicator::enqueue(const std::string& json_str, CommandPriority priority, const std::string& command_id, bool is_command) {
+    std::lock_guard<std::mutex> lock(outgoing_mutex);
+    bool was_empty = outgoing_control.empty() && outgoing.empty();
+    if (outgoing_control.size() + outgoing.size() >= static_cast<size_t>(Constants::MAX_OUTGOING_MESSAGES)) return false;
+    // Counted before the ROUTER thread can send it, so the reply always finds it pending.
+    if (is_command) command_sent(command_id);
+
+    Outgoing message{json_str, command_id, is_command, priority};
+    if (priority == CommandPriority::CONTROL) {
+        outgoing_control.push_back(std::move(message));
+    } else if (priority == CommandPriority::ABORT) {
+        // Ahead of the queued settings, behind the mode commands and stops sent before it.
+        auto position = outgoing.end();
+        while (position != outgoing.begin() && std::prev(position)->priority == CommandPriority::NORMAL) --position;
+        outgoing.insert(position, std::move(message));
+    } else {
+        outgoing.push_back(std::move(message));
+    }
+
+    // The ROUTER thread takes everything queued once awake, so only the first message wakes it.
+    if (was_empty) wake_send.send(zmq::message_t(), zmq::send_flags::dontwait);
+    return true;
+}
+
+void ZmqCommunicator::flush_outgoing() {
+    std::deque<Outgoing> batch;
+    {
+        std::lock_guard<std::mutex> lock(outgoing_mutex);
+        batch.swap(outgoing_control);
+        for (Outgoing& message : outgoing) batch.push_back(std::move(message));
+        outgoing.clear();
+    }
+    if (batch.empty()) return;
+    if (!active) {
+        fail_unsent(batch);
+        return;
+    }
+    for (const Outgoing& message : batch) {
+        OSC_TRACE_SCOPE("router/send");
+        send_to(active->dealer, message.json_str);
+    }
+}
+
+void ZmqCommunicator::fail_unsent(const std::deque<Outgoing>& batch) {
+    bool mirror_changed = false;
+    for (const Outgoing& message : batch) {
+        if (!message.is_command) continue;
+        drop_pending(message.command_id);
+        mirror_changed |= settings_mirror.lost(message.command_id);
+        metrics.add(Metrics::ERR_NOT_CONNECTED);
+        reply_svc.update(active_lost ? "Error: Python backend not responding (no heartbeat)." : "Error: Python client not connected.");
+    }
+    if (mirror_changed) publish_settings();
+}
+
+void ZmqCommunicator::reject_command(const std::string& command, const std::string& message) {
+    LOG_WARN("Rejected {}: {}", command, message);
+    reply_svc.update("Error: " + message);
+}
+
+bool ZmqCommunicator::answer_from_settings(const std::string& query) {
+    if (!client_connected) return false;
+    // SCOPE/REPLY carries no id: with any command still unanswered this answer would overtake its
+    // reply. Held while answering, so no command counts as sent before the answer is out.
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if (!pending_commands.empty()) return false;
+    std::string value = settings_mirror.answer(query);
+    if (value.empty()) return false;
+    metrics.add(Metrics::SETTINGS_ANSWERED);
+    reply_svc.update(value);
+    return true;
+}
+
+void ZmqCommunicator::publish_settings() {
+    settings_svc->update(settings_mirror.snapshot().dump());
+}
+
+void ZmqCommunicator::set_auto_range(int channel, bool enabled) {
+    auto_range.set_enabled(channel, enabled);
+    LOG_INFO("Auto-range {} on channel {}", enabled ? "started" : "stopped", channel + 1);
+    auto_range_svc->update(auto_range.status().dump());
+}
+
+void ZmqCommunicator::send_control(const std::string& json_str) {
+    if (!client_connected) return;
+    LOG_DEBUG("Sending control message to Python: {}", json_str);
+    // The next periodic refresh repairs a control message lost to a full queue, but it is counted.
+    if (!enqueue(json_str, CommandPriority::CONTROL, "", false)) metrics.add(Metrics::ERR_QUEUE_FULL);
+}
+
+void ZmqCommunicator::grant_credit() {
+    uint64_t consumed = frames_consumed.load();
+    granted_consumed = consumed;
+
+    json message;
+    message[Constants::JSON_TYPE] = "control";
+    message[Constants::JSON_COMMAND] = Constants::PY_GRANT_CREDIT;
+    message[Constants::JSON_PARAMS] = {{"window", Constants::CREDIT_WINDOW}, {"consumed", consumed}, {"epoch", credit_epoch}};
+    send_control(message.dump());
+}
+
+void ZmqCommunicator::return_credit() {
+    // In batches of half a window; any publisher may cross the threshold.
+    uint64_t consumed = frames_consumed.fetch_add(1) + 1;
+    if (consumed - granted_consumed.load() >= static_cast<uint64_t>(Constants::CREDIT_WINDOW / 2)) grant_credit();
+}
+
+void ZmqCommunicator::update_demand() {
+    std::vector<int> wanted;
+    for (size_t ch = 0; ch < channel_sinks.size(); ++ch) {
+        // Sinks that cannot count their readers (-1) are assumed to be read.
+        bool read = std::any_of(channel_sinks[ch].begin(), channel_sinks[ch].end(),
+            [](OutputSink* sink) { return sink->subscribers() != 0; });
+        if (read) wanted.push_back(static_cast<int>(ch) + 1);
+    }
+
+    if (wanted == wanted_channels && !demand_resend.exchange(false)) return;
+    if (wanted != wanted_channels) LOG_INFO("Wanted channels changed to {} of {}", json(wanted).dump(), channel_sinks.size());
+    wanted_channels = wanted;
+
+    json message;
+    message[Constants::JSON_TYPE] = "control";
+    message[Constants::JSON_COMMAND] = Constants::PY_SET_WANTED_CHANNELS;
+    message[Constants::JSON_PARAMS] = {{Constants::JSON_CHANNELS, wanted_channels}};
+    send_control(message.dump());
+}
+
+void ZmqCommunicator::command_sent(const std::string& id) {
+    metrics.add(Metrics::COMMANDS_SENT);
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    pending_commands.emplace_back(id, monotonic_ns());
+    metrics.set_pending_commands(pending_commands.size());
+}
+
+void ZmqCommunicator::reply_received(const std::string& id) {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    if (pending_commands.empty()) return;
+
+    // Backends that do not echo the id answer in order, so fall back to the oldest command.
+    auto it = pending_commands.begin();
+    if (!id.empty()) {
+        it = std::find_if(pending_commands.begin(), pending_commands.end(),
+            [&id](const std::pair<std::string, int64_t>& pending) { return pending.first == id; });
+        if (it == pending_commands.end()) return;
+    }
+    reply_latency.record(monotonic_ns() - it->second);
+    pending_commands.erase(it);
+    metrics.set_pending_commands(pending_commands.size());
+}
+
+void ZmqCommunicator::drop_pending(const std::string& id) {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    auto it = std::find_if(pending_commands.begin(), pending_commands.end(),
+        [&id](const std::pair<std::string, int64_t>& pending) { return pending.first == id; });
+    if (it == pending_commands.end()) return;
+    pending_commands.erase(it);
+    metrics.set_pending_commands(pending_commands.size());
+}
+
+void ZmqCommunicator::expire_pending_commands() {
+    int64_t cutoff = monotonic_ns() - static_cast<int64_t>(Constants::REPLY_EXPIRY_MS) * 1000000;
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    while (!pending_commands.empty() && pending_commands.front().second < cutoff) {
+        if (settings_mirror.lost(pending_commands.front().first)) publish_settings();
+        pending_commands.pop_front();
+        metrics.add(Metrics::ERR_REPLY_EXPIRED);
+    }
+    metrics.set_pending_commands(pending_commands.size());
 }
 
 void ZmqCommunicator::router_loop() {
+    set_current_thread_name("osc-router");
     while (running) {
+        // Wakes up for replies, for messages other threads queued, and every ROUTER_POLL_MS for the heartbeats.
+        zmq::pollitem_t items[] = {{router_socket.handle(), 0, ZMQ_POLLIN, 0}, {wake_receive.handle(), 0, ZMQ_POLLIN, 0}};
+        zmq::poll(items, 2, std::chrono::milliseconds(Constants::ROUTER_POLL_MS));
+        if (items[1].revents & ZMQ_POLLIN) {
+            zmq::message_t wake;
+            while (wake_receive.recv(wake, zmq::recv_flags::dontwait)) {}
+        }
+
         zmq::multipart_t multipart_msg;
-        if (multipart_msg.recv(router_socket, ZMQ_DONTWAIT)) {
-            {
-                std::lock_guard<std::mutex> lock(client_id_mutex);
-                python_client_id = std::move(multipart_msg.at(0));
-            }
+        if ((items[0].revents & ZMQ_POLLIN) && multipart_msg.recv(router_socket, ZMQ_DONTWAIT)) {
+            OSC_TRACE_SCOPE("router/message");
+            handle_backend_message(multipart_msg.at(0), multipart_msg.at(2).to_string());
+        }
+        heartbeat_tick(monotonic_ns());
+        if (client_connected) flush_outgoing();
+    }
+}
+
+void ZmqCommunicator::handle_backend_message(zmq::message_t& sender, const std::string& text) {
+    json j = json::parse(text, nullptr, false);
+    if (!j.is_object()) {
+        metrics.add(Metrics::ERR_MALFORMED_JSON);
+        reply_svc.update("Error: Malformed JSON from Python.");
+        return;
+    }
+    std::string type = j.value(Constants::JSON_TYPE, "");
+
+    if (type == "handshake") {
+        handle_handshake(sender, j);
+        return;
+    }
+    if (type == "heartbeat") {
+        handle_heartbeat(sender, j);
+        return;
+    }
+
+    if (!active) {
+        active = std::make_unique<BackendLink>();
+        active->dealer = std::move(sender);
+        active->publish_endpoint = default_sub_endpoint;
+        client_connected = true;
+    } else if (sender != active->dealer) {
+        if (standby && sender == standby->dealer) return;   // A standby has nothing to answer yet
+        if (active->handshaken) {
+            // Another DEALER on this instrument's port: never let it take over the replies.
+            metrics.add(Metrics::ERR_UNKNOWN_CLIENT);
+            return;
+        }
+        active->dealer = std::move(sender);
+    }
+
+    if (type == "reply") {
+        std::string id = j.value(Constants::JSON_ID, "");
+        if (settings_mirror.replied(id, j.value(Constants::JSON_STATUS, "") == "ok")) publish_settings();
+        if (j.value(Constants::JSON_STATUS, "") == "ok") {
+            metrics.add(Metrics::REPLIES_OK);
+            reply_svc.update(j.value(Constants::JSON_PAYLOAD, "[empty]"));
+        } else {
+            metrics.add(Metrics::REPLIES_ERROR);
+            reply_svc.update("Error: " + j.value(Constants::JSON_MESSAGE, "[no msg]"));
+        }
+        // Pending until its reply is out: answer_from_settings must not publish before it.
+        reply_received(id);
+    } else if (type == "settings") {
+        // The backend's readback; after the replies of the commands it ran before it.
+        settings_mirror.readback(j.value("settings", json::object()));
+        publish_settings();
+    }
+}
+
+void ZmqCommunicator::handle_handshake(zmq::message_t& sender, const json& message) {
+    // Backends without an instrument number predate multi-instrument servers: they are instrument 1.
+    int number = message.value(Constants::JSON_INSTRUMENT, 1);
+    if (number != instrument.number) {
+        metrics.add(Metrics::ERR_UNKNOWN_CLIENT);
+        LOG_ERROR("Handshake of instrument {} on the port of {}: ignored, check the backend's endpoints",
+                  number, instrument.prefix);
+        return;
+    }
 
-            std::string received_str = multipart_msg.at(2).to_string();
+    auto link = std::make_unique<BackendLink>();
+    link->backend = message.value(Constants::JSON_BACKEND, "");
+    link->dealer = std::move(sender);
+    link->handshaken = true;
+    link->publish_endpoint = message.value(Constants::JSON_PUBLISH_ENDPOINT, default_sub_endpoint);
+    set_subscribed(link->publish_endpoint, true);
+
+    // The link replaced here stops being read, unless the other role publishes on the same endpoint.
+    auto release = [this](const std::unique_ptr<BackendLink>& old, const std::unique_ptr<BackendLink>& other,
+                          const std::string& kept) {
+        if (!old || old->publish_endpoint == kept) return;
+        if (other && other->publish_endpoint == old->publish_endpoint) return;
+        set_subscribed(old->publish_endpoint, false);
+    };
+
+    if (message.value(Constants::JSON_ROLE, "primary") == "standby") {
+        release(standby, active, link->publish_endpoint);
+        standby = std::move(link);
+        LOG_INFO("Standby backend '{}' of {} registered, publishing on {}", standby->backend, instrument.prefix,
+                 standby->publish_endpoint);
+        return;
+    }
+
+    release(active, standby, link->publish_endpoint);
+    active = std::move(link);
+    heartbeat_rtt.reset();
+    active_lost = false;
+    client_connected = true;
+    LOG_INFO("Python client '{}' of {} connected with handshake.", active->backend, instrument.prefix);
+    demand_resend = true;
+    grant_credit();
+}
+
+void ZmqCommunicator::handle_heartbeat(zmq::message_t& sender, const json& message) {
+    std::string backend = message.value(Constants::JSON_BACKEND, "");
+    BackendLink* link = nullptr;
+    if (!backend.empty() && active && active->backend == backend) link = active.get();
+    else if (!backend.empty() && standby && standby->backend == backend) link = standby.get();
+    // A hello can overtake its backend's handshake; the backend repeats it until heartbeats come.
+    if (!link) return;
+
+    int64_t now = monotonic_ns();
+    if (!link->beating) LOG_INFO("Heartbeats from backend '{}' of {}", link->backend, instrument.prefix);
+    link->heartbeat_dealer = std::move(sender);
+    link->beating = true;
+    link->last_beat_ns = now;
+    if (link != active.get()) return;
+
+    if (message.contains("sent_ns")) heartbeat_rtt.record(now - message.value("sent_ns", now));
+    if (active_lost) {
+        LOG_WARN("Backend '{}' of {} answers heartbeats again", active->backend, instrument.prefix);
+        active_lost = false;
+        client_connected = true;
+        demand_resend = true;
+        grant_credit();
+    }
+}
+
+void ZmqCommunicator::heartbeat_tick(int64_t now_ns) {
+    if (now_ns < next_heartbeat_ns) return;
+    next_heartbeat_ns = now_ns + static_cast<int64_t>(Constants::HEARTBEAT_INTERVAL_MS) * 1000000;
+    OSC_TRACE_SCOPE("router/heartbeat");
+
+    json ping;
+    ping[Constants::JSON_TYPE] = "control";
+    ping[Constants::JSON_COMMAND] = Constants::PY_HEARTBEAT;
+    ping[Constants::JSON_PARAMS] = {{"seq", ++heartbeat_seq}, {"sent_ns", now_ns}};
+    std::string text = ping.dump();
+    for (BackendLink* link : {active.get(), standby.get()}) {
+        if (link && link->beating) send_to(link->heartbeat_dealer, text);
+    }
+
+    // Backends without a heartbeat thread are never declared lost.
+    const int64_t timeout_ns = static_cast<int64_t>(Constants::HEARTBEAT_TIMEOUT_MS) * 1000000;
+    if (active && active->beating && !active_lost && now_ns - active->last_beat_ns > timeout_ns) lose_active();
+
+    auto link_status = [now_ns](const BackendLink* link) -> json {
+        if (!link) return nullptr;
+        return {
+            {"backend", link->backend},
+            {"heartbeats", link->beating},
+            {"last_beat_ms", link->beating ? json((now_ns - link->last_beat_ns) / 1e6) : json()},
+            {"publish_endpoint", link->publish_endpoint}
+        };
+    };
+    json status = {
+        {"interval_ms", Constants::HEARTBEAT_INTERVAL_MS},
+        {"timeout_ms", Constants::HEARTBEAT_TIMEOUT_MS},
+        {"active", link_status(active.get())},
+        {"active_lost", active_lost.load()},
+        {"standby", link_status(standby.get())}
+    };
+    std::lock_guard<std::mutex> lock(heartbeat_mutex);
+    heartbeat_status = std::move(status);
+}
+
+void ZmqCommunicator::lose_active() {
+    metrics.add(Metrics::ERR_BACKEND_LOST);
+    LOG_ERROR("No heartbeat from backend '{}' of {} for {} ms", active->backend, instrument.prefix,
+              Constants::HEARTBEAT_TIMEOUT_MS);
+    // Whatever was sent to it will not be answered, and a standby may not repeat it safely.
+    fail_pending_commands();
+
+    const int64_t timeout_ns = static_cast<int64_t>(Constants::HEARTBEAT_TIMEOUT_MS) * 1000000;
+    if (!standby || !standby->beating || monotonic_ns() - standby->last_beat_ns > timeout_ns) {
+        active_lost = true;
+        client_connected = false;
+        return;
+    }
+
+    // Stop reading the old backend, so it cannot publish next to its successor if it wakes up.
+    if (active->publish_endpoint != standby->publish_endpoint) set_subscribed(active->publish_endpoint, false);
+    active = std::move(standby);
+    heartbeat_rtt.reset();
+    metrics.add(Metrics::FAILOVERS);
+    LOG_WARN("Standby backend '{}' of {} promoted", active->backend, instrument.prefix);
+
+    json promote;
+    promote[Constants::JSON_TYPE] = "control";
+    promote[Constants::JSON_COMMAND] = Constants::PY_PROMOTE;
+    promote[Constants::JSON_PARAMS] = json::object();
+    client_connected = true;
+    send_control(promote.dump());
+    demand_resend = true;
+    grant_credit();
+}
+
+void ZmqCommunicator::fail_pending_commands() {
+    {
+        std::lock_guard<std::mutex> lock(outgoing_mutex);
+        outgoing_control.clear();
+        outgoing.clear();
+    }
+    std::string ids;
+    size_t failed = 0;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        for (const auto& pending : pending_commands) {
+            ids += (failed++ ? ", " : "") + pending.first;
+            settings_mirror.lost(pending.first);
+        }
+        pending_commands.clear();
+        metrics.set_pending_commands(0);
+    }
+    if (failed == 0) return;
+    publish_settings();
+    metrics.add(Metrics::ERR_COMMAND_FAILED, failed);
+    reply_svc.update("Error: Python backend not responding, " + std::to_string(failed) + " command(s) failed: " + ids);
+}
+
+void ZmqCommunicator::set_subscribed(const std::string& endpoint, bool connected) {
+    if (endpoint.empty() || (sub_endpoints.count(endpoint) != 0) == connected) return;
+    if (connected) sub_endpoints.insert(endpoint);
+    else sub_endpoints.erase(endpoint);
+    std::lock_guard<std::mutex> lock(sub_changes_mutex);
+    sub_changes.emplace_back(connected, endpoint);
+}
+
+void ZmqCommunicator::send_to(zmq::message_t& identity, const std::string& json_str) {
+    zmq::message_t routing_id;
+    routing_id.copy(identity);
+    router_socket.send(routing_id, zmq::send_flags::sndmore);
+    router_socket.send(zmq::buffer(""), zmq::send_flags::sndmore);
+    router_socket.send(zmq::buffer(json_str), zmq::send_flags::none);
+}
+
+void ZmqCommunicator::subscribe_loop() {
+    set_current_thread_name("osc-subscribe");
+    zmq::multipart_t multipart_msg;
+    Frame frame;
+    while (running) {
+        // Backends coming and going (handshakes, failover) change the PUB sockets to read.
+        std::vector<std::pair<bool, std::string>> changes;
+        {
+            std::lock_guard<std::mutex> lock(sub_changes_mutex);
+            changes.swap(sub_changes);
+        }
+        for (const auto& [connect, endpoint] : changes) {
             try {
-                json j = json::parse(received_str);
-                if (j.value(Constants::JSON_TYPE, "") == "handshake") {
-                    std::cout << "Python client connected with handshake." << std::endl;
-                } else if (j.value(Constants::JSON_TYPE, "") == "reply") {
-                    if (j.value(Constants::JSON_STATUS, "") == "ok") {
-                        reply_svc.update(j.value(Constants::JSON_PAYLOAD, "[empty]"));
-                    } else {
-                        reply_svc.update("Error: " + j.value(Constants::JSON_MESSAGE, "[no msg]"));
-                    }
-                }
-            } catch (const json::parse_error& e) {
-                reply_svc.update("Error: Malformed JSON from Python.");
+                if (connect) sub_socket.connect(endpoint);
+                else sub_socket.disconnect(endpoint);
+                LOG_INFO("ZMQ SUB {} {}", connect ? "connected to" : "disconnected from", endpoint);
+            } catch (const zmq::error_t& e) {
+                LOG_ERROR("ZMQ SUB cannot {} {}: {}", connect ? "connect to" : "disconnect from", endpoint, e.what());
             }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        zmq::pollitem_t items[] = {{sub_socket.handle(), 0, ZMQ_POLLIN, 0}};
+        zmq::poll(items, 1, std::chrono::milliseconds(Constants::SUB_POLL_MS));
+
+        // Drain what arrived. Decoding and handing over is all this thread does, so the socket
+        // is read at the rate frames arrive, whatever publishing them costs.
+        while (multipart_msg.recv(sub_socket, ZMQ_DONTWAIT)) {
+            frame.received_ns = monotonic_ns();
+            frame.topic = multipart_msg.popstr();
+            frame.payload = multipart_msg.popstr();
+            frame.header = multipart_msg.empty() ? std::string() : multipart_msg.popstr();
+            route(frame);
+        }
     }
 }
 
-void ZmqCommunicator::subscribe_loop() {
+void ZmqCommunicator::route(Frame& frame) {
+    size_t index = publishers.size() - 1;   // The 'other' publisher
+    bool waveform = false;
+    if (frame.topic.rfind(Constants::ZMQ_WAVEFORM_TOPIC_BASE, 0) == 0) {
+        int channel = std::atoi(frame.topic.c_str() + Constants::ZMQ_WAVEFORM_TOPIC_BASE.length());
+        if (channel >= 1 && channel <= Constants::OSC_NUM_CHANNELS) {
+            index = channel - 1;
+            waveform = true;
+        }
+    }
+    if (!publishers[index]->offer(frame)) {
+        // Only a backend ignoring its credit can fill a channel queue.
+        metrics.add(Metrics::ERR_FRAME_DROPPED);
+        if (waveform) return_credit();
+    }
+}
+
+void ZmqCommunicator::metrics_loop() {
+    set_current_thread_name("osc-metrics");
+    std::unique_lock<std::mutex> lock(metrics_mutex);
     while (running) {
-        zmq::multipart_t multipart_msg;
-        if (multipart_msg.recv(sub_socket, ZMQ_DONTWAIT)) {
-            std::string topic = multipart_msg.popstr();
-            std::string payload = multipart_msg.popstr();
+        metrics_wakeup.wait_for(lock, std::chrono::milliseconds(Constants::STATS_PUBLISH_PERIOD_MS),
+            [this] { return !running; });
+        if (!running) break;
 
-            if (topic == Constants::ZMQ_STATE_TOPIC) {
-                state_svc.update(payload);
-            }
-            else if(topic == Constants::ZMQ_TIMEDIV_TOPIC){
-                timediv_svc.update(payload);
-            }
-            else if (topic.rfind(Constants::ZMQ_WAVEFORM_TOPIC_BASE, 0) == 0) {
-                try {
-                    // Extract channel number from topic string (e.g., "waveform_ch1" -> 0)
-                    std::string ch_str = topic.substr(Constants::ZMQ_WAVEFORM_TOPIC_BASE.length());
-                    int ch_index = std::stoi(ch_str) - 1;
-
-                    if (ch_index >= 0 && ch_index < Constants::OSC_NUM_CHANNELS) {
-                        // Call the thread-safe update on the correct service
-                        waveform_svcs[ch_index]->update(payload);
-                    }
-                } catch (const std::exception& e) {
-                    // Handle cases like "waveform_chABC" or out-of-range index
-                    std::cerr << "Error processing topic '" << topic << "': " << e.what() << std::endl;
+        OSC_TRACE_SCOPE("metrics/publish");
+        expire_pending_commands();
+        update_demand();
+        // Also refreshes a grant the backend missed; grants are cumulative, so repeating one is harmless.
+        grant_credit();
+        latency_svc->update(latency.summary().dump());
+
+        json snapshot = metrics.snapshot(reply_latency.summary());
+        json subscribers = json::array();
+        for (auto& svc : waveform_svcs) subscribers.push_back(svc->subscribers());
+        snapshot["demand"] = {{"wanted_channels", wanted_channels}, {"waveform_subscribers", subscribers}};
+        snapshot["credit"] = {{"window", Constants::CREDIT_WINDOW}, {"frames_consumed", frames_consumed.load()}};
+        json queues = json::array();
+        for (auto& publisher : publishers) queues.push_back({{"queued", publisher->queued()}, {"handled", publisher->handled()}});
+        snapshot["publishers"] = queues;
+        snapshot["analysis"] = analysis_pool.status();
+        {
+            std::lock_guard<std::mutex> heartbeat_lock(heartbeat_mutex);
+            snapshot["heartbeat"] = heartbeat_status;
+        }
+        snapshot["heartbeat"]["rtt"] = heartbeat_rtt.summary();
+        metrics_svc->update(snapshot.dump());
+    }
+}
+
+void ZmqCommunicator::dispatch(const Frame& frame) {
+    const std::string& topic = frame.topic;
+    const std::string& payload = frame.payload;
+
+    OSC_TRACE_SCOPE("dispatch");
+    if (topic == Constants::ZMQ_STATE_TOPIC) {
+        metrics.add_message(Metrics::TOPIC_STATE, payload.size());
+        state_svc->update(payload);
+    }
+    else if(topic == Constants::ZMQ_TIMEDIV_TOPIC){
+        metrics.add_message(Metrics::TOPIC_TIMEDIV, payload.size());
+        timediv_svc->update(payload);
+    }
+    else if (topic == Constants::ZMQ_TIMING_TOPIC) {
+        metrics.add_message(Metrics::TOPIC_TIMING, payload.size());
+        if (duty_cycle.add(json::parse(payload, nullptr, false))) {
+            timing_svc->update(duty_cycle.summary().dump());
+        } else {
+            metrics.add(Metrics::ERR_BAD_TOPIC);
+        }
+    }
+    else if (topic == Constants::ZMQ_SEQUENCE_TOPIC) {
+        metrics.add_message(Metrics::TOPIC_SEQUENCE, payload.size());
+        sequence_svc->update(payload);
+    }
+    else if (topic == Constants::ZMQ_SETUP_SLOTS_TOPIC) {
+        metrics.add_message(Metrics::TOPIC_OTHER, payload.size());
+        setup_slots_svc->update(payload);
+    }
+    else if (topic.rfind(Constants::ZMQ_WAVEFORM_TOPIC_BASE, 0) == 0) {
+        try {
+            // Extract channel number from topic string (e.g., "waveform_ch1" -> 0)
+            std::string ch_str = topic.substr(Constants::ZMQ_WAVEFORM_TOPIC_BASE.length());
+            int ch_index = std::stoi(ch_str) - 1;
+
+            if (ch_index >= 0 && ch_index < Constants::OSC_NUM_CHANNELS) {
+                OSC_TRACE_SCOPE_VALUE("dispatch/waveform", ch_index + 1);
+                metrics.add_message(static_cast<Metrics::Topic>(Metrics::TOPIC_WAVEFORM_CH1 + ch_index), payload.size());
+                json header = frame.header.empty() ? json() : json::parse(frame.header, nullptr, false);
+                json trace;
+                if (header.is_object() && header.contains(Constants::JSON_TRACE)) {
+                    trace = std::move(header[Constants::JSON_TRACE]);
+                    header.erase(Constants::JSON_TRACE);
+                }
+                int64_t decoded_ns = monotonic_ns();
+
+                // Analysis of the frame. Only channels still auto-ranging pay for parsing their samples.
+                double scale = header.is_object() ? header.value(Constants::JSON_SCALE, 0.0) : 0.0;
+                bool publish = true;
+                TaskGraph analysis(analysis_pool);
+                if (scale > 0.0 && auto_range.seeking(ch_index)) {
+                    TaskGraph::Id parsed = analysis.add("parse", [&] { Waveform::parse(payload, range_samples[ch_index]); });
+                    analysis.add("auto_range", [&] {
+                        AutoRange::Decision decision = auto_range.evaluate(ch_index, range_samples[ch_index], scale);
+                        if (decision.new_scale > 0.0) {
+                            json command;
+                            command[Constants::JSON_ID] = "auto_range_" + std::to_string(auto_range_counter++);
+                            command[Constants::JSON_COMMAND] = Constants::PY_SET_CHAN_SCALE;
+                            command[Constants::JSON_PARAMS] = {{Constants::JSON_CHANNEL, ch_index + 1}, {Constants::JSON_SCALE, decision.new_scale}};
+                            LOG_INFO("Auto-range: channel {} from {} to {} V/div", ch_index + 1, scale, decision.new_scale);
+                            send_command(command.dump());
+                        }
+                        auto_range_svc->update(auto_range.status().dump());
+                        publish = decision.publish;     // False when acquired at the old scale after a change
+                    }, {parsed});
                 }
+                if (!analysis.empty()) {
+                    OSC_TRACE_SCOPE_VALUE("dispatch/analysis", ch_index + 1);
+                    int64_t analysis_start_ns = monotonic_ns();
+                    analysis.run();
+                    analysis_pool.timing("frame").record(monotonic_ns() - analysis_start_ns);
+                }
+                if (!publish) return;
+
+                // The metadata goes out first, so a client reacting to CH<x> already sees its window.
+                // Its sequence number lets clients tell the CH<x> updates they missed.
+                if (!header.is_object()) header = json::object();
+                header[Constants::JSON_SEQUENCE] = ++published_frames[ch_index];
+                meta_svcs[ch_index]->update(header.dump());
+
+                // Call the thread-safe update on the correct service
+                waveform_svcs[ch_index]->update(payload);
+
+                if (!trace.is_null()) {
+                    latency.record(trace, frame.received_ns, decoded_ns, monotonic_ns());
+                }
+            } else {
+                metrics.add(Metrics::ERR_BAD_TOPIC);
             }
+        } catch (const std::exception& e) {
+            // Handle cases like "waveform_chABC" or out-of-range index
+            metrics.add(Metrics::ERR_BAD_TOPIC);
+            LOG_ERROR("Error processing topic '{}': {}", topic, e.what());
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Reduced sleep for better responsiveness
+    }
+    else {
+        metrics.add_message(Metrics::TOPIC_OTHER, payload.size());
     }
 }
\ No newline at end of file
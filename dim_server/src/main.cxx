@@ -2,27 +2,56 @@
 #include "DimServices.h"
 #include "CommandRegistry.h"
 #include "Constants.h"
-#include <iostream>
+#include "Log.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
 #include <thread>
 #include <chrono>
 
 int main() {
-    ReplyService reply_service;
-    ZmqCommunicator zmq_comm(reply_service);
+    // debug, info (default), warn, error or off
+    if (const char* level = std::getenv("OSC_LOG_LEVEL")) Log::set_level(Log::parse_level(level));
+    // Timeline tracing from the start (otherwise SCOPE/DEBUG/TRACE ON); kill -USR1 dumps it.
+    if (const char* trace = std::getenv("OSC_TRACE")) Trace::set_enabled(std::string(trace) == "1");
+    Trace::install_signal_handler();
+    // Workers of the frame analysis pool
+    size_t analysis_threads = Constants::ANALYSIS_THREADS;
+    if (const char* threads = std::getenv("OSC_ANALYSIS_THREADS")) analysis_threads = std::strtoul(threads, nullptr, 10);
 
-    // This single function call creates and registers all our commands.
-    // To add a new command, you just modify the lists in CommandRegistry.cpp
-    register_all_commands(zmq_comm);
+    // One communicator per oscilloscope backend: SCOPE/... for one, SCOPE1/.. SCOPE<n>/... for several.
+    int instrument_count = 1;
+    if (const char* count = std::getenv("OSC_INSTRUMENTS")) {
+        instrument_count = std::min(std::max(1, std::atoi(count)), Constants::MAX_INSTRUMENTS);
+    }
+
+    DimSinkFactory dim_sinks;
+    std::vector<std::unique_ptr<ReplyService>> reply_services;
+    std::vector<std::unique_ptr<ZmqCommunicator>> communicators;
+    for (int number = 1; number <= instrument_count; ++number) {
+        Instrument instrument = Instrument::numbered(number, instrument_count);
+        reply_services.push_back(std::make_unique<ReplyService>(instrument.service(Constants::REPLY_SERVICE)));
+        communicators.push_back(std::make_unique<ZmqCommunicator>(*reply_services.back(), dim_sinks, instrument, analysis_threads));
+
+        // This single function call creates and registers all our commands.
+        // To add a new command, you just modify the lists in CommandRegistry.cpp
+        register_all_commands(*communicators.back());
+
+        communicators.back()->start(instrument.router_endpoint, instrument.sub_endpoint);
+        LOG_INFO("Instrument {} served as {}/", number, instrument.prefix);
+    }
+    register_server_commands();
 
-    zmq_comm.start(Constants::ZMQ_ROUTER_ENDPOINT, Constants::ZMQ_SUB_ENDPOINT);
-    
     DimServer::start(Constants::SERVER_NAME);
-    std::cout << "DIM Server '" << Constants::SERVER_NAME << "' started." << std::endl;
+    LOG_INFO("DIM Server '{}' started.", Constants::SERVER_NAME);
 
     while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(5));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        Trace::service_signal();
     }
 
-    zmq_comm.stop();
+    for (auto& communicator : communicators) communicator->stop();
     return 0;
 }
\ No newline at end of file
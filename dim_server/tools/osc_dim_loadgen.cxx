@@ -0,0 +1,374 @@
+// Fan-out load generator for the DIM side of osc_dim_server.
+//
+// Subscribes N stamped DimInfo clients to the server's services and measures, per client, the
+// update rate, the updates missed (gaps in the sequence number of CH<x>/META, which goes out just
+// before each CH<x> update) and the delivery latency against the publish timestamp of each update.
+// Services without a META sequence are measured without missed updates. The DIM
+// client library shares one connection per process, so clients are spread over several processes
+// to load the server with as many connections as wanted. Run it against osc_fake_backend to get
+// fan-out scaling curves, e.g. for n in 1 10 20 50 100: osc_dim_loadgen --clients $n --csv
+//
+// Usage: osc_dim_loadgen [--clients <n>] [--processes <n>] [--services <name,...>] [--duration <s>]
+//                        [--warmup <s>] [--dns <node>] [--csv]
+
+#include "Constants.h"
+
+// Standard CPP libraries
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Outside dependencies
+#include <dic.hxx>
+
+namespace {
+
+struct Options {
+    int clients = 20;
+    int processes = 0;          // 0: one per 10 clients
+    std::vector<std::string> services;
+    double duration_s = 10.0;
+    double warmup_s = 2.0;
+    std::string dns;
+    bool csv = false;
+};
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--clients <n>] [--processes <n>] [--services <name,...>] [--duration <s>]\n"
+              << "       [--warmup <s>] [--dns <node>] [--csv]" << std::endl;
+}
+
+char NO_LINK[] = "__OSC_LOADGEN_NO_LINK__";
+
+// A larger jump, or one backwards, means the server restarted; do not count it as missed updates.
+constexpr int64_t MAX_PLAUSIBLE_GAP = 1000000;
+
+int64_t wall_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct ClientResult {
+    int client_id = 0;
+    std::string service;
+    uint64_t updates = 0;
+    uint64_t missed = 0;
+    uint64_t bytes = 0;
+    uint64_t disconnects = 0;
+    std::vector<int32_t> latency_ms;
+};
+
+// The "sequence" of a CH<x>/META update, or -1 if it has none.
+int64_t meta_sequence(const char* text) {
+    const char* key = std::strstr(text, "\"sequence\":");
+    return key ? std::strtoll(key + std::strlen("\"sequence\":"), nullptr, 10) : -1;
+}
+
+// The latest sequence number of a CH<x>/META service. The DIM client thread delivers the updates of
+// one server in order, so a CH<x> update finds the sequence of the META update sent just before it.
+class MetaSequence : public DimInfo {
+public:
+    explicit MetaSequence(const std::string& service) : DimInfo(service.c_str(), NO_LINK) {}
+
+    void infoHandler() override { latest = meta_sequence(getString()); }
+
+    int64_t latest = -1;
+};
+
+// Callbacks run on the DIM client thread; the main thread only starts and stops the measurement.
+class LoadClient : public DimStampedInfo {
+public:
+    LoadClient(int client_id, const std::string& service) :
+        DimStampedInfo(service.c_str(), NO_LINK)
+    {
+        result.client_id = client_id;
+        result.service = service;
+        const std::string& suffix = Constants::WAVEFORM_META_SUFFIX;
+        bool is_meta = service.size() > suffix.size() && service.compare(service.size() - suffix.size(), suffix.size(), suffix) == 0;
+        if (!is_meta && service.find(Constants::WAVEFORM_SERVICE_BASE) != std::string::npos) {
+            meta = std::make_unique<MetaSequence>(service + suffix);
+        }
+    }
+
+    void infoHandler() override {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (getSize() == static_cast<int>(sizeof(NO_LINK)) && std::strcmp(getString(), NO_LINK) == 0) {
+            if (measuring) ++result.disconnects;
+            has_last = false;
+            return;
+        }
+
+        int64_t sequence = meta ? meta->latest : meta_sequence(getString());
+        int64_t latency = wall_clock_ms() - (static_cast<int64_t>(getTimestamp()) * 1000 + getTimestampMillisecs());
+        if (!measuring) {
+            last_sequence = sequence;
+            has_last = true;
+            return;
+        }
+
+        if (has_last && sequence >= 0 && last_sequence >= 0) {
+            int64_t step = sequence - last_sequence;
+            if (step == 0) return;   // Same update delivered twice (e.g. on reconnect)
+            if (step > 1 && step < MAX_PLAUSIBLE_GAP) result.missed += static_cast<uint64_t>(step - 1);
+        }
+        last_sequence = sequence;
+        has_last = true;
+
+        ++result.updates;
+        result.bytes += static_cast<uint64_t>(getSize());
+        result.latency_ms.push_back(static_cast<int32_t>(latency));
+    }
+
+    void set_measuring(bool on) {
+        std::lock_guard<std::mutex> lock(mtx);
+        measuring = on;
+    }
+
+    ClientResult take_result() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return std::move(result);
+    }
+
+private:
+    std::mutex mtx;
+    bool measuring = false;
+    bool has_last = false;
+    int64_t last_sequence = -1;
+    ClientResult result;
+    std::unique_ptr<MetaSequence> meta;     // For CH<x>: its META service
+};
+
+// Child process <-> parent pipe format
+// ==========================================================
+struct WireHeader {
+    int32_t client_id;
+    char service[128];
+    uint64_t updates, missed, bytes, disconnects, latency_count;
+};
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int run_child(const Options& options, int first_client, int last_client, int fd) {
+    if (!options.dns.empty()) DimClient::setDnsNode(options.dns.c_str());
+
+    std::vector<std::unique_ptr<LoadClient>> clients;
+    for (int id = first_client; id < last_client; ++id) {
+        clients.push_back(std::make_unique<LoadClient>(id, options.services[id % options.services.size()]));
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup_s));
+    for (auto& client : clients) client->set_measuring(true);
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.duration_s));
+    for (auto& client : clients) client->set_measuring(false);
+
+    for (auto& client : clients) {
+        ClientResult result = client->take_result();
+        WireHeader header{};
+        header.client_id = result.client_id;
+        std::strncpy(header.service, result.service.c_str(), sizeof(header.service) - 1);
+        header.updates = result.updates;
+        header.missed = result.missed;
+        header.bytes = result.bytes;
+        header.disconnects = result.disconnects;
+        header.latency_count = result.latency_ms.size();
+        if (!write_all(fd, &header, sizeof(header)) ||
+            !write_all(fd, result.latency_ms.data(), result.latency_ms.size() * sizeof(int32_t))) {
+            return 1;
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+// Reporting
+// ==========================================================
+double percentile(const std::vector<int32_t>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+struct Summary {
+    int clients = 0;
+    uint64_t updates = 0, missed = 0, bytes = 0, disconnects = 0;
+    double min_client_rate = 0.0;
+    std::vector<int32_t> latency_ms;
+};
+
+void add_to_summary(Summary& summary, const ClientResult& result, double duration_s) {
+    double rate = result.updates / duration_s;
+    summary.min_client_rate = summary.clients == 0 ? rate : std::min(summary.min_client_rate, rate);
+    ++summary.clients;
+    summary.updates += result.updates;
+    summary.missed += result.missed;
+    summary.bytes += result.bytes;
+    summary.disconnects += result.disconnects;
+    summary.latency_ms.insert(summary.latency_ms.end(), result.latency_ms.begin(), result.latency_ms.end());
+}
+
+void print_row(const std::string& name, Summary& summary, double duration_s) {
+    std::sort(summary.latency_ms.begin(), summary.latency_ms.end());
+    uint64_t expected = summary.updates + summary.missed;
+    std::cout << std::left << std::setw(28) << name << std::right
+              << std::setw(8) << summary.clients
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << summary.updates / duration_s / std::max(1, summary.clients)
+              << std::setw(12) << summary.min_client_rate
+              << std::setw(12) << summary.bytes / duration_s / 1e6
+              << std::setw(10) << summary.missed
+              << std::setprecision(2) << std::setw(9) << (expected ? 100.0 * summary.missed / expected : 0.0) << "%"
+              << std::setprecision(0)
+              << std::setw(8) << percentile(summary.latency_ms, 0.50)
+              << std::setw(8) << percentile(summary.latency_ms, 0.90)
+              << std::setw(8) << percentile(summary.latency_ms, 0.99)
+              << std::setw(8) << (summary.latency_ms.empty() ? 0 : summary.latency_ms.back())
+              << std::setw(8) << summary.disconnects << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) options.clients = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--processes" && i + 1 < argc) options.processes = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--duration" && i + 1 < argc) options.duration_s = std::max(0.1, std::atof(argv[++i]));
+        else if (arg == "--warmup" && i + 1 < argc) options.warmup_s = std::max(0.0, std::atof(argv[++i]));
+        else if (arg == "--dns" && i + 1 < argc) options.dns = argv[++i];
+        else if (arg == "--csv") options.csv = true;
+        else if (arg == "--services" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!name.empty()) options.services.push_back(name);
+            }
+        }
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.services.empty()) {
+        for (int ch = 0; ch < Constants::OSC_NUM_CHANNELS; ++ch) {
+            options.services.push_back(Constants::WAVEFORM_SERVICE_BASE + std::to_string(ch + 1));
+        }
+    }
+    if (options.processes == 0) options.processes = (options.clients + 9) / 10;
+    options.processes = std::min(options.processes, options.clients);
+
+    std::cerr << "Subscribing " << options.clients << " clients from " << options.processes << " processes to "
+              << options.services.size() << " services; warm-up " << options.warmup_s << " s, measuring "
+              << options.duration_s << " s..." << std::endl;
+
+    // Fork before any DIM call: the client library starts its threads on first use.
+    std::vector<std::pair<pid_t, int>> children;
+    for (int p = 0; p < options.processes; ++p) {
+        int first = p * options.clients / options.processes;
+        int last = (p + 1) * options.clients / options.processes;
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            _exit(run_child(options, first, last, fds[1]));
+        }
+        close(fds[1]);
+        children.emplace_back(pid, fds[0]);
+    }
+
+    std::vector<ClientResult> results;
+    for (auto& child : children) {
+        WireHeader header;
+        while (read_all(child.second, &header, sizeof(header))) {
+            ClientResult result;
+            result.client_id = header.client_id;
+            result.service = header.service;
+            result.updates = header.updates;
+            result.missed = header.missed;
+            result.bytes = header.bytes;
+            result.disconnects = header.disconnects;
+            result.latency_ms.resize(header.latency_count);
+            if (!read_all(child.second, result.latency_ms.data(), header.latency_count * sizeof(int32_t))) break;
+            results.push_back(std::move(result));
+        }
+        close(child.second);
+        int status = 0;
+        waitpid(child.first, &status, 0);
+    }
+    if (results.size() != static_cast<size_t>(options.clients)) {
+        std::cerr << "Warning: results from " << results.size() << " of " << options.clients << " clients" << std::endl;
+    }
+
+    std::map<std::string, Summary> per_service;
+    Summary total;
+    for (const auto& result : results) {
+        add_to_summary(per_service[result.service], result, options.duration_s);
+        add_to_summary(total, result, options.duration_s);
+    }
+
+    std::cout << std::left << std::setw(28) << "service" << std::right << std::setw(8) << "clients"
+              << std::setw(12) << "upd/s/cl" << std::setw(12) << "min upd/s" << std::setw(12) << "MB/s"
+              << std::setw(10) << "missed" << std::setw(10) << "missed%"
+              << std::setw(8) << "p50 ms" << std::setw(8) << "p90 ms" << std::setw(8) << "p99 ms"
+              << std::setw(8) << "max ms" << std::setw(8) << "discon" << std::endl;
+    for (auto& entry : per_service) print_row(entry.first, entry.second, options.duration_s);
+    print_row("all", total, options.duration_s);
+
+    if (options.csv) {
+        // total was sorted by print_row
+        uint64_t expected = total.updates + total.missed;
+        std::cout << "clients,processes,updates_per_s,mb_per_s,missed_pct,p50_ms,p99_ms,max_ms\n"
+                  << options.clients << "," << options.processes << ","
+                  << std::setprecision(1) << total.updates / options.duration_s << ","
+                  << total.bytes / options.duration_s / 1e6 << ","
+                  << std::setprecision(3) << (expected ? 100.0 * total.missed / expected : 0.0) << ","
+                  << std::setprecision(0) << percentile(total.latency_ms, 0.50) << ","
+                  << percentile(total.latency_ms, 0.99) << ","
+                  << (total.latency_ms.empty() ? 0 : total.latency_ms.back()) << std::endl;
+    }
+    return 0;
+}
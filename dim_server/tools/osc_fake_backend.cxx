@@ -0,0 +1,504 @@
+// Synthetic stand-in for the Python backend, for load-testing osc_dim_server.
+//
+// Connects to the server's ROUTER as a DEALER, answers the command protocol of BackendWorker with
+// plausible replies and publishes waveform_ch<x>, waveform_timediv and backend_state at a fixed rate.
+// Waveforms are generated and formatted once at start-up (and again when SET_WINDOW changes the
+// transferred window); the publish loop only cycles through them.
+//
+// Usage: osc_fake_backend [--router <endpoint>] [--pub <endpoint>] [--rate <Hz>] [--length <samples>]
+//                         [--channels <n>] [--shape sine|noise|pulse|mix] [--variants <n>] [--autostart]
+
+#include "Waveform.h"
+#include "LatencyHistogram.h"
+#include "Constants.h"
+
+// Standard CPP libraries
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Outside dependencies
+#include <zmq.hpp>
+#include <zmq_addon.hpp>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+struct Options {
+    std::string router_endpoint = "tcp://localhost:5555";
+    // The server connects its SUB to Constants::ZMQ_SUB_ENDPOINT, so bind the matching port.
+    std::string pub_endpoint = "tcp://*:5558";
+    // Instrument number sent in the handshake; with the default endpoints it also picks the ports
+    // of that instrument on a server run with OSC_INSTRUMENTS.
+    int instrument = 1;
+    bool endpoints_given = false;
+    double rate_hz = 10.0;
+    size_t record_length = 10000;
+    int channels = Constants::OSC_NUM_CHANNELS;
+    std::string shape = "mix";
+    int variants = 16;
+    bool autostart = false;
+};
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [--router <endpoint>] [--pub <endpoint>] [--instrument <n>] [--rate <Hz>]\n"
+              << "       [--length <samples>] [--channels <n>] [--shape sine|noise|pulse|mix] [--variants <n>] [--autostart]"
+              << std::endl;
+}
+
+// Waveform synthesis
+// ==========================================================
+enum class Shape { SINE, NOISE, PULSE };
+
+Shape shape_for_channel(const std::string& shape, int channel) {
+    if (shape == "sine") return Shape::SINE;
+    if (shape == "noise") return Shape::NOISE;
+    if (shape == "pulse") return Shape::PULSE;
+    // "mix": the PMT channels are what we usually look at, so half of them pulse.
+    static const Shape mix[] = {Shape::PULSE, Shape::SINE, Shape::PULSE, Shape::NOISE};
+    return mix[channel % 4];
+}
+
+void synthesize(Shape shape, std::mt19937& rng, std::vector<double>& samples) {
+    std::normal_distribution<double> noise(0.0, 1.5e-3);
+    const size_t n = samples.size();
+
+    switch (shape) {
+    case Shape::SINE: {
+        std::uniform_real_distribution<double> phase(0.0, 2.0 * M_PI);
+        const double p = phase(rng);
+        for (size_t i = 0; i < n; ++i) samples[i] = 0.1 * std::sin(2.0 * M_PI * 5.0 * i / n + p) + noise(rng);
+        break;
+    }
+    case Shape::NOISE:
+        for (size_t i = 0; i < n; ++i) samples[i] = 5.0 * noise(rng);
+        break;
+    case Shape::PULSE: {
+        // Negative PMT pulses: fast rise, exponential tail, random amplitude, one at the trigger point.
+        for (size_t i = 0; i < n; ++i) samples[i] = noise(rng);
+        std::uniform_int_distribution<size_t> position(0, n - 1);
+        std::exponential_distribution<double> amplitude(1.0 / 0.04);
+        std::poisson_distribution<int> extra_pulses(2.0);
+        const double tau_rise = n / 5000.0 + 1.0;
+        const double tau_fall = n / 1000.0 + 4.0;
+
+        std::vector<size_t> starts = {n / 10};
+        for (int k = extra_pulses(rng); k > 0; --k) starts.push_back(position(rng));
+        for (size_t start : starts) {
+            const double a = 0.01 + amplitude(rng);
+            const size_t end = std::min(n, start + static_cast<size_t>(tau_fall * 10));
+            for (size_t i = start; i < end; ++i) {
+                const double t = static_cast<double>(i - start);
+                samples[i] -= a * (std::exp(-t / tau_fall) - std::exp(-t / tau_rise));
+            }
+        }
+        break;
+    }
+    }
+}
+
+// Fake device state
+// ==========================================================
+struct FakeScope {
+    std::string state = "IDLE";
+    std::vector<bool> enabled;
+    std::vector<bool> wanted;       // Channels with a DIM reader, from the server's set_wanted_channels
+    std::vector<double> scale;
+    double timediv = 4.0e-5;
+    double trigger_level = 0.0;
+    int trigger_channel = 1;
+    std::string trigger_slope = "RISE";
+    double timeout = 200.0;
+    bool ignore_timeout = false;
+    size_t record_length;
+    std::string sampling_mode = "SAMPLE";
+    int sampling_count = 1;
+    size_t window_start = 1;    // DATA:START..STOP, 1-based and inclusive
+    size_t window_stop;
+
+    FakeScope(int active_channels, size_t length) :
+        enabled(Constants::OSC_NUM_CHANNELS, false),
+        wanted(Constants::OSC_NUM_CHANNELS, true),
+        scale(Constants::OSC_NUM_CHANNELS, 5.0e-2),
+        record_length(length),
+        window_stop(length)
+    {
+        for (int ch = 0; ch < active_channels && ch < Constants::OSC_NUM_CHANNELS; ++ch) enabled[ch] = true;
+    }
+
+    std::string answer_query(const std::string& query) const {
+        if (query == "*IDN?") return "TEKTRONIX,TDS 3054C,0,CF:91.1CT FV:v4.05 TDS3FFT:v1.00";
+        if (query == "BUSY?") return "0";
+        if (query == "WFMPRE:XINCR?" || query == "WFMPre:XINcr?") return format_number(time_increment());
+        if (query == "SELECT?") {
+            std::string reply;
+            for (int ch = 0; ch < Constants::OSC_NUM_CHANNELS; ++ch) reply += (enabled[ch] ? "1;" : "0;");
+            return reply + "0;0;0;0;0;CONTROL CH1";
+        }
+        if (query.size() == 10 && query.compare(0, 2, "CH") == 0 && query.compare(3, 7, ":SCALE?") == 0) {
+            int ch = query[2] - '1';
+            if (ch >= 0 && ch < Constants::OSC_NUM_CHANNELS) return format_number(scale[ch]);
+        }
+        return "0";
+    }
+
+    // Ten horizontal divisions spread over the record.
+    double time_increment() const { return timediv * 10.0 / record_length; }
+
+    static std::string format_number(double value) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.4E", value);
+        return text;
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--router" && has_value) { options.router_endpoint = argv[++i]; options.endpoints_given = true; }
+        else if (arg == "--pub" && has_value) { options.pub_endpoint = argv[++i]; options.endpoints_given = true; }
+        else if (arg == "--instrument" && has_value) options.instrument = std::atoi(argv[++i]);
+        else if (arg == "--rate" && has_value) options.rate_hz = std::atof(argv[++i]);
+        else if (arg == "--length" && has_value) options.record_length = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--channels" && has_value) options.channels = std::atoi(argv[++i]);
+        else if (arg == "--shape" && has_value) options.shape = argv[++i];
+        else if (arg == "--variants" && has_value) options.variants = std::atoi(argv[++i]);
+        else if (arg == "--autostart") options.autostart = true;
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.rate_hz <= 0 || options.record_length == 0 || options.variants <= 0 ||
+        options.channels < 1 || options.channels > Constants::OSC_NUM_CHANNELS ||
+        options.instrument < 1 || options.instrument > Constants::MAX_INSTRUMENTS) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!options.endpoints_given && options.instrument > 1) {
+        int offset = (options.instrument - 1) * Constants::INSTRUMENT_PORT_STRIDE;
+        options.router_endpoint = "tcp://localhost:" + std::to_string(5555 + offset);
+        options.pub_endpoint = "tcp://*:" + std::to_string(5558 + offset);
+    }
+
+    // Preallocate every frame up front so the publish loop does no formatting or allocation.
+    std::cout << "Generating " << options.variants << " x " << options.channels << " waveforms of "
+              << options.record_length << " samples..." << std::endl;
+    std::vector<std::vector<std::vector<double>>> records(options.channels);
+    std::vector<std::vector<std::string>> frames(options.channels);
+    std::vector<std::string> topics;
+    {
+        std::mt19937 rng(42);
+        std::vector<double> samples(options.record_length);
+        for (int ch = 0; ch < options.channels; ++ch) {
+            topics.push_back(Constants::ZMQ_WAVEFORM_TOPIC_BASE + std::to_string(ch + 1));
+            Shape shape = shape_for_channel(options.shape, ch);
+            for (int v = 0; v < options.variants; ++v) {
+                synthesize(shape, rng, samples);
+                records[ch].push_back(samples);
+            }
+        }
+    }
+
+    FakeScope scope(options.channels, options.record_length);
+    std::map<int, FakeScope> saved_setups;
+
+    // Credit flow control, as in BackendWorker: frames beyond the granted window are skipped and counted.
+    bool credit_granted = false;
+    uint64_t credit_limit = 0;      // consumed + window of the last grant
+    int64_t credit_epoch = 0;
+    uint64_t frames_sent = 0;
+    uint64_t skipped_no_credit = 0;
+    auto format_frames = [&]() {
+        for (int ch = 0; ch < options.channels; ++ch) {
+            frames[ch].resize(options.variants);
+            for (int v = 0; v < options.variants; ++v) {
+                const double* first = records[ch][v].data() + scope.window_start - 1;
+                Waveform::format(first, scope.window_stop - scope.window_start + 1, frames[ch][v]);
+            }
+        }
+    };
+    format_frames();
+    if (options.autostart) scope.state = "CONTINUOUS_ACQUISITION";
+
+    zmq::context_t context(1);
+    zmq::socket_t dealer(context, zmq::socket_type::dealer);
+    zmq::socket_t pub(context, zmq::socket_type::pub);
+    dealer.connect(options.router_endpoint);
+    pub.bind(options.pub_endpoint);
+
+    // Replies by default; other messages (handshake) carry their own type.
+    auto send_to_server = [&dealer](json reply) {
+        if (!reply.contains(Constants::JSON_TYPE)) reply[Constants::JSON_TYPE] = "reply";
+        dealer.send(zmq::buffer(""), zmq::send_flags::sndmore);
+        dealer.send(zmq::buffer(reply.dump()), zmq::send_flags::none);
+    };
+    auto publish = [&pub](const std::string& topic, const std::string& payload) {
+        pub.send(zmq::buffer(topic), zmq::send_flags::sndmore);
+        pub.send(zmq::buffer(payload), zmq::send_flags::none);
+    };
+    // Waveforms carry the same trace header as the Python backend. There is no trigger wait or
+    // transfer here, so arm/complete/transfer collapse onto the frame tick.
+    auto publish_waveform = [&pub, &scope](int ch, const std::string& topic, const std::string& payload, int64_t tick_ns) {
+        json header;
+        header[Constants::JSON_TRACE] = {{"arm", tick_ns}, {"complete", tick_ns}, {"transfer_start", tick_ns},
+                                         {"transfer", tick_ns}, {"format", tick_ns}, {"publish", monotonic_ns()}};
+        header["window"] = {{"start", scope.window_start}, {"stop", scope.window_stop}};
+        header[Constants::JSON_SCALE] = scope.scale[ch];
+        if (scope.sampling_mode != "SAMPLE") header["sampling"] = {{"mode", scope.sampling_mode}, {"count", scope.sampling_count}};
+        pub.send(zmq::buffer(topic), zmq::send_flags::sndmore);
+        pub.send(zmq::buffer(payload), zmq::send_flags::sndmore);
+        pub.send(zmq::buffer(header.dump()), zmq::send_flags::none);
+    };
+    auto set_state = [&](const std::string& new_state) {
+        if (scope.state == new_state) return;
+        scope.state = new_state;
+        publish(Constants::ZMQ_STATE_TOPIC, scope.state);
+    };
+
+    // Same contract as BackendWorker.COMMAND_MAP: returns the reply payload or throws.
+    using Handler = std::function<std::string(const json&)>;
+    std::map<std::string, Handler> command_map = {
+        {Constants::PY_SET_CHAN_ENABLED, [&](const json& p) {
+            scope.enabled.at(p.at(Constants::JSON_CHANNEL).get<int>() - 1) = p.at("enabled").get<bool>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_CHAN_SCALE, [&](const json& p) {
+            scope.scale.at(p.at(Constants::JSON_CHANNEL).get<int>() - 1) = p.at("scale").get<double>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_TRIG_CHANNEL, [&](const json& p) {
+            scope.trigger_channel = p.at(Constants::JSON_CHANNEL).get<int>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_TRIG_SLOPE, [&](const json& p) {
+            scope.trigger_slope = p.at("slope").get<std::string>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_TRIG_LEVEL, [&](const json& p) {
+            scope.trigger_level = p.at("level").get<double>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_ACQ_TIMEDIV, [&](const json& p) {
+            scope.timediv = p.at("level").get<double>();
+            return std::string("Success");
+        }},
+        {Constants::PY_SET_ACQ_TIMEOUT, [&](const json& p) {
+            scope.timeout = p.at("level").get<double>();
+            if (scope.timeout <= 0.0) return std::string("Timeout set to adaptive.");
+            return "Timeout set to " + FakeScope::format_number(scope.timeout) + " s.";
+        }},
+        {Constants::PY_SET_ACQ_IGNORE, [&](const json& p) {
+            scope.ignore_timeout = p.at("state").get<bool>();
+            return std::string("Ignore timeout set to ") + (scope.ignore_timeout ? "True." : "False.");
+        }},
+        {Constants::PY_SET_ACQ_WINDOW, [&](const json& p) {
+            int start = p.at("start").get<int>();
+            int stop = p.at("stop").get<int>();
+            if (start <= 0) {
+                scope.window_start = 1;
+                scope.window_stop = scope.record_length;
+            } else if (stop < start || static_cast<size_t>(stop) > scope.record_length) {
+                throw std::runtime_error("Invalid data window " + std::to_string(start) + ".." + std::to_string(stop));
+            } else {
+                scope.window_start = start;
+                scope.window_stop = stop;
+            }
+            format_frames();
+            return start <= 0 ? std::string("Window reset to the full record.")
+                               : "Window set to samples " + std::to_string(start) + ".." + std::to_string(stop) + ".";
+        }},
+        // Only reported in the header: the frames stay single-shot (and no min/max pairs for ENVELOPE).
+        {Constants::PY_SET_ACQ_SAMPLING, [&](const json& p) {
+            std::string mode = p.at("mode").get<std::string>();
+            if (mode != "SAMPLE" && mode != "AVERAGE" && mode != "ENVELOPE") {
+                throw std::runtime_error("Invalid sampling mode: " + mode);
+            }
+            scope.sampling_mode = mode;
+            scope.sampling_count = mode == "SAMPLE" ? 1 : p.value("count", 16);
+            return mode == "SAMPLE" ? std::string("Sampling mode set to SAMPLE.")
+                                    : "Sampling mode set to " + mode + " of " + std::to_string(scope.sampling_count) + " acquisitions.";
+        }},
+        {Constants::PY_SET_ACQ_MODE, [&](const json& p) {
+            std::string mode = p.at("state").get<std::string>();
+            if (mode == "CONT" || mode == "SINGLE") {
+                if (scope.state != "IDLE") {
+                    throw std::runtime_error("Cannot start acquisition from the current state: " + scope.state);
+                }
+                set_state(mode == "CONT" ? "CONTINUOUS_ACQUISITION" : "SINGLE");
+                return mode == "CONT" ? std::string("Continuous acquisition started.") : std::string("Single acquisition started.");
+            }
+            if (mode == "OFF") {
+                if (scope.state == "IDLE") return std::string("Warning: Acquisition is not currently running.");
+                set_state("IDLE");
+                return std::string("Acquisition stopped.");
+            }
+            throw std::runtime_error("Invalid acquisition state: " + mode);
+        }},
+        // *SAV/*RCL keep a copy of the whole fake scope; a recall restores its settings, not its state.
+        {Constants::PY_SAVE_SETUP, [&](const json& p) {
+            int slot = p.at("slot").get<int>();
+            if (slot < 1 || slot > 10) throw std::runtime_error("Setup slot must be 1-10, given " + std::to_string(slot));
+            saved_setups.erase(slot);
+            saved_setups.emplace(slot, scope);
+            json slots = json::object();
+            for (const auto& entry : saved_setups) {
+                json scales = json::object();
+                for (int ch = 0; ch < Constants::OSC_NUM_CHANNELS; ++ch) scales[std::to_string(ch + 1)] = entry.second.scale[ch];
+                slots[std::to_string(entry.first)] = {{"sampling", {{"mode", entry.second.sampling_mode}, {"count", entry.second.sampling_count}}},
+                                                      {"scales", scales}};
+            }
+            publish(Constants::ZMQ_SETUP_SLOTS_TOPIC, slots.dump());
+            return "Setup saved to slot " + std::to_string(slot) + ".";
+        }},
+        {Constants::PY_RECALL_SETUP, [&](const json& p) {
+            int slot = p.at("slot").get<int>();
+            auto saved = saved_setups.find(slot);
+            if (saved == saved_setups.end()) throw std::runtime_error("Setup slot " + std::to_string(slot) + " is empty");
+            const FakeScope& setup = saved->second;
+            scope.enabled = setup.enabled;
+            scope.scale = setup.scale;
+            scope.timediv = setup.timediv;
+            scope.trigger_level = setup.trigger_level;
+            scope.trigger_channel = setup.trigger_channel;
+            scope.trigger_slope = setup.trigger_slope;
+            scope.sampling_mode = setup.sampling_mode;
+            scope.sampling_count = setup.sampling_count;
+            return "Setup recalled from slot " + std::to_string(slot) + ".";
+        }},
+        {Constants::PY_RAW_QUERY, [&](const json& p) {
+            return scope.answer_query(p.at(Constants::JSON_QUERY).get<std::string>());
+        }},
+        {Constants::PY_RAW_WRITE, [&](const json&) {
+            return std::string("OK");
+        }},
+    };
+
+    send_to_server({{Constants::JSON_TYPE, "handshake"}, {Constants::JSON_INSTRUMENT, options.instrument},
+                    {Constants::JSON_PAYLOAD, "Fake backend online"}});
+    std::cout << "DEALER connected to " << options.router_endpoint << ", PUB bound to " << options.pub_endpoint
+              << ", publishing at " << options.rate_hz << " Hz" << std::endl;
+
+    using clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / options.rate_hz));
+    auto next_frame = clock::now();
+    uint64_t frame_counter = 0;
+    int64_t last_cycle_end = 0;   // 0: no previous cycle in this run
+    uint64_t published_frames = 0;
+    auto last_report = clock::now();
+
+    while (true) {
+        // Wait for a command, but never past the next frame.
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - clock::now());
+        zmq::pollitem_t items[] = {{dealer.handle(), 0, ZMQ_POLLIN, 0}};
+        zmq::poll(items, 1, std::max(wait, std::chrono::milliseconds(0)));
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            zmq::multipart_t request;
+            request.recv(dealer);
+            json reply;
+            std::string command;
+            json id;
+            try {
+                json j = json::parse(request.at(request.size() - 1).to_string());
+                command = j.value(Constants::JSON_COMMAND, "");
+                // Control messages are applied silently, as in BackendWorker._dispatch_control: they have
+                // no id, so an error is logged rather than answered.
+                if (j.value(Constants::JSON_TYPE, "") == "control") {
+                    try {
+                        if (command == Constants::PY_SET_WANTED_CHANNELS) {
+                            std::fill(scope.wanted.begin(), scope.wanted.end(), false);
+                            for (int ch : j.at(Constants::JSON_PARAMS).at(Constants::JSON_CHANNELS)) scope.wanted.at(ch - 1) = true;
+                        } else if (command == Constants::PY_GRANT_CREDIT) {
+                            const json& params = j.at(Constants::JSON_PARAMS);
+                            uint64_t consumed = params.at("consumed").get<uint64_t>();
+                            int64_t epoch = params.at("epoch").get<int64_t>();
+                            if (!credit_granted || epoch != credit_epoch) frames_sent = consumed;
+                            credit_granted = true;
+                            credit_epoch = epoch;
+                            credit_limit = consumed + params.at("window").get<uint64_t>();
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Ignoring control message '" << command << "': " << e.what() << std::endl;
+                    }
+                    continue;
+                }
+                if (j.contains(Constants::JSON_ID)) id = j[Constants::JSON_ID];
+                auto handler = command_map.find(command);
+                if (handler == command_map.end()) {
+                    reply = {{Constants::JSON_STATUS, "error"}, {Constants::JSON_MESSAGE, "Unknown command: '" + command + "'"}};
+                } else {
+                    reply = {{Constants::JSON_STATUS, "ok"},
+                             {Constants::JSON_PAYLOAD, handler->second(j.value(Constants::JSON_PARAMS, json::object()))}};
+                }
+            } catch (const std::exception& e) {
+                reply = {{Constants::JSON_STATUS, "error"}, {Constants::JSON_MESSAGE, std::string("Internal fake backend error: ") + e.what()}};
+            }
+            if (!id.is_null()) reply[Constants::JSON_ID] = id;
+            send_to_server(reply);
+        }
+
+        auto now = clock::now();
+        if (now < next_frame) continue;
+        next_frame += period;
+        if (next_frame < now) next_frame = now + period; // Do not burst to catch up after a stall.
+
+        if (scope.state != "CONTINUOUS_ACQUISITION" && scope.state != "SINGLE") {
+            last_cycle_end = 0;
+            continue;
+        }
+
+        // One acquisition cycle, in the same order as _perform_one_acquisition_cycle.
+        const uint64_t cycle = frame_counter++;
+        const size_t variant = cycle % options.variants;
+        const int64_t tick_ns = monotonic_ns();
+        for (int ch = 0; ch < options.channels; ++ch) {
+            if (!scope.enabled[ch] || !scope.wanted[ch]) continue;
+            if (credit_granted && frames_sent >= credit_limit) {
+                ++skipped_no_credit;
+                continue;
+            }
+            publish_waveform(ch, topics[ch], frames[ch][variant], tick_ns);
+            ++frames_sent;
+        }
+        publish(Constants::ZMQ_TIMEDIV_TOPIC, FakeScope::format_number(scope.time_increment()));
+        ++published_frames;
+
+        // The wait for the frame tick stands in for the wait for a trigger.
+        const int64_t cycle_start = last_cycle_end ? last_cycle_end : tick_ns;
+        const int64_t cycle_end = monotonic_ns();
+        json timing = {
+            {"cycle", cycle}, {"start", cycle_start}, {"end", cycle_end}, {"timeout", false},
+            {"previous_end", last_cycle_end ? json(last_cycle_end) : json()},
+            {"phases", {{"wait_for_trigger", tick_ns - cycle_start}, {"publish", cycle_end - tick_ns}}}
+        };
+        publish(Constants::ZMQ_TIMING_TOPIC, timing.dump());
+        last_cycle_end = cycle_end;
+
+        if (scope.state == "SINGLE") set_state("IDLE");
+
+        if (now - last_report >= std::chrono::seconds(5)) {
+            double seconds = std::chrono::duration<double>(now - last_report).count();
+            std::cout << "Published " << published_frames / seconds << " frames/s, "
+                      << skipped_no_credit << " channel frames skipped without credit" << std::endl;
+            published_frames = 0;
+            last_report = now;
+        }
+    }
+    return 0;
+}
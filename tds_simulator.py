@@ -0,0 +1,29 @@
+import argparse
+import logging
+import sys
+
+from zmq_server.simulator.TDS3054C_sim import SimulatorConfig, serve
+
+# Point the 'connection_params' of your TDS3054C profile at this host/port to use the simulator.
+DEFAULT_HOST = "127.0.0.1"
+DEFAULT_PORT = 8080
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="TDS3054C web-interface (Comm.html) simulator")
+    parser.add_argument("--host", default=DEFAULT_HOST)
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--latency-ms", type=float, default=30.0, help="fixed cost of every HTTP request")
+    parser.add_argument("--throughput-kbps", type=float, default=1000.0, help="response payload rate, 0 = unlimited")
+    parser.add_argument("--trigger-rate", type=float, default=50.0, help="mean trigger rate in Hz")
+    parser.add_argument("--record-length", type=int, default=10000, help="points per channel record")
+    parser.add_argument("--seed", type=int, default=1234, help="seed for waveforms and trigger times")
+    parser.add_argument("-v", "--verbose", action="store_true", help="log every request")
+    args = parser.parse_args()
+
+    logging.basicConfig(stream=sys.stdout, level=logging.DEBUG if args.verbose else logging.INFO,
+                        format='%(asctime)s - %(levelname)s - %(message)s')
+
+    config = SimulatorConfig(latency_ms=args.latency_ms, throughput_kbps=args.throughput_kbps,
+                             trigger_rate_hz=args.trigger_rate, record_length=args.record_length,
+                             seed=args.seed)
+    serve(args.host, args.port, config)
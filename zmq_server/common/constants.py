@@ -17,10 +17,36 @@ class Command(Enum):
     SET_ACQUISITION_TIMEDIV = "set_acquisition_timediv"
     SET_ACQUISITION_TIMEOUT = "set_acquisition_timeout"
     SET_ACQUISITION_IGNORE = "set_acquisition_ignore"
+    SET_ACQUISITION_WINDOW = "set_acquisition_window"
+    SET_ACQUISITION_SAMPLING = "set_acquisition_sampling"
+    RUN_SEQUENCE = "run_sequence"
+    SAVE_SETUP = "save_setup"
+    RECALL_SETUP = "recall_setup"
     RAW_QUERY = "raw_query"
     RAW_WRITE = "raw_write"
 
+class Control(Enum):
+    """
+    Control messages from the C++ server. They arrive on the same DEALER socket as commands,
+    tagged with "type": "control", and are never answered.
+    """
+    # params: {"channels": [1, 3]} -- the channels with at least one DIM reader
+    SET_WANTED_CHANNELS = "set_wanted_channels"
+    # params: {"window": 16, "consumed": 1234, "epoch": <server instance>} -- waveform frames the
+    # backend may publish: consumed + window in total
+    GRANT_CREDIT = "grant_credit"
+    # params: {"seq": 17, "sent_ns": <server clock>} -- sent to the heartbeat DEALER, echoed while healthy
+    HEARTBEAT = "heartbeat"
+    # params: {} -- a standby backend is now the active one, after the active one stopped answering
+    PROMOTE = "promote"
+
 class AcquistionMode(Enum):
     CONTINUOUS = "CONT"
     SINGLE = "SINGLE"
-    OFF = "OFF"
\ No newline at end of file
+    OFF = "OFF"
+
+class SamplingMode(Enum):
+    """How the instrument builds one acquisition (ACQuire:MODe)."""
+    SAMPLE = "SAMPLE"       # One trigger, one record
+    AVERAGE = "AVERAGE"     # Mean of 'count' triggers
+    ENVELOPE = "ENVELOPE"   # Min/max of 'count' triggers; the record holds min,max pairs
\ No newline at end of file
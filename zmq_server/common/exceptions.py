@@ -60,6 +60,10 @@ class AcquisitionTimeoutError(AcquisitionError): # Note: It inherits from Acquis
     """Raised specifically when an acquisition times out waiting for a trigger."""
     pass
 
+class AcquisitionAbortedError(AcquisitionError):
+    """Raised when an acquisition is given up for a stop command, e.g. while waiting for a trigger."""
+    pass
+
 #====================================================================================
 # ZMQ Server errors
 #====================================================================================
@@ -98,15 +98,52 @@ class Oscilloscope(ABC):
         """"Sets the trigger source"""
         pass
     
+    def get_vertical_scale(self, channel: int) -> float:
+        """Reads the vertical scale (Volts/Div) of a channel. Optional."""
+        raise NotImplementedError("This driver cannot read the vertical scale.")
+
+    def get_horizontal_scale(self) -> float:
+        """Reads the horizontal scale (Seconds/Div). Optional."""
+        raise NotImplementedError("This driver cannot read the horizontal scale.")
+
+    def set_sampling_mode(self, mode: str, count: int) -> None:
+        """
+        Selects instrument-side SAMPLE, AVERAGE (of 'count' triggers) or ENVELOPE (over 'count' triggers)
+        acquisition for the following sample() calls. Optional.
+        """
+        raise NotImplementedError("This driver only supports SAMPLE acquisition.")
+
+    def get_sampling_mode(self) -> tuple:
+        """Reads the instrument's (mode, count), as accepted by set_sampling_mode. Optional."""
+        raise NotImplementedError("This driver cannot read the sampling mode.")
+
+    def save_setup(self, slot: int) -> None:
+        """Stores the current front-panel setup in the instrument's memory slot 'slot'. Optional."""
+        raise NotImplementedError("This driver has no setup memory.")
+
+    def recall_setup(self, slot: int) -> None:
+        """Restores the setup stored in 'slot' and returns once it is in effect. Optional."""
+        raise NotImplementedError("This driver has no setup memory.")
+
+    def set_data_window(self, start: int, stop: int) -> None:
+        """
+        Limits the waveform transfer to samples start..stop (1-based, inclusive) of the record.
+        start <= 0 restores the full record. Optional: drivers without it always transfer the full record.
+        """
+        raise NotImplementedError("This driver cannot limit the waveform transfer.")
+
     def get_waveform(self, channel:int) -> str:
         '''
         Acquisition of registered waveform
         '''
         pass
 
-    def sample(self, timeout: int = 60):
+    def sample(self, timeout: int = 60, poll_interval: float = 0.01, should_abort=None):
             '''
-            Runs oscilloscope in single sequence mode and waits for a single acquistion -- optional implementation of timeout feature
+            Runs oscilloscope in single sequence mode and waits for a single acquistion -- optional implementation of timeout feature.
+            poll_interval (s) is the period of the completion checks while waiting.
+            should_abort, if given, is called at every check; when it returns True the acquisition is
+            stopped and AcquisitionAbortedError raised.
             '''
             pass
 
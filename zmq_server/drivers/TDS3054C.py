@@ -20,6 +20,9 @@ class EthernetSocket():
         self.port = port
         self.timeout = 15
         self.current_connection = None
+        # time.monotonic() at the start of the request in progress, None between requests. Read by
+        # the backend's heartbeat thread to tell a stuck request from a long acquisition.
+        self.request_started = None
     
     def connect(self) -> socket.socket:
         '''
@@ -62,6 +65,7 @@ class EthernetSocket():
         '''
         Opens connection, sends request and returns byte response
         '''
+        self.request_started = time.monotonic()
         try:
             # Open connection
             s = self.connect()
@@ -83,10 +87,23 @@ class EthernetSocket():
         except (DeviceConnectionError, socket.timeout, OSError) as e:
             self.close()
             raise DeviceCommunicationError("Failed to send or receive data from device.") from e
+        finally:
+            self.request_started = None
 
 
 
 class TDS3054C(Oscilloscope):
+    # Longest record of the TDS3000 series; DATA:STOP beyond the actual record length is clamped by the scope.
+    MAX_RECORD_LENGTH = 10000
+    AVERAGE_COUNTS = (2, 4, 8, 16, 32, 64, 128, 256, 512)   # ACQuire:NUMAVg
+    MAX_ENVELOPE_COUNT = 2000                              # ACQuire:NUMEnv
+    SETUP_SLOTS = range(1, 11)                             # *SAV / *RCL
+    # The settings mirrored by the DIM server, in one concatenated query. SELECT? answers 10 fields
+    # (CH1-4, MATH, REF1-4, CONTROL), every other query one.
+    SETTINGS_QUERY = ("SELECT?;:CH1:SCALE?;:CH2:SCALE?;:CH3:SCALE?;:CH4:SCALE?;:HORIZONTAL:MAIN:SCALE?;"
+                      ":TRIGGER:A:EDGE:SOURCE?;:TRIGGER:A:EDGE:SLOPE?;:TRIGGER:A:LEVEL?;"
+                      ":ACQUIRE:MODE?;:ACQUIRE:NUMAVG?;:ACQUIRE:NUMENV?")
+
     def __init__(self, connection_params: dict):
         '''
         Define IPv4 and Port number for future connections.
@@ -96,6 +113,18 @@ class TDS3054C(Oscilloscope):
         port = connection_params.get('port')
         self.socket = EthernetSocket(ip, port)
 
+        # Durations (s) of the phases of the last sample() call: configure, arm, wait_for_trigger
+        self.last_sample_phases = {}
+
+        # ACQuire:MODe applied by sample(); see set_sampling_mode. None keeps the scope's own
+        # mode, e.g. the one restored by recall_setup().
+        self.sampling_mode = "SAMPLE"
+
+
+    @property
+    def request_started(self):
+        """time.monotonic() at the start of the HTTP request in progress, None between requests."""
+        return self.socket.request_started
 
     def make_connection(self):
         '''
@@ -239,6 +268,12 @@ class TDS3054C(Oscilloscope):
             raise DeviceCommandError(f"Failed to set vertical scale for channel {channel}.") from e
         
 
+    def get_vertical_scale(self, channel: int) -> float:
+        try:
+            return float(self.query(f"CH{channel}:SCAle?"))
+        except (DeviceCommandError, ValueError) as e:
+            raise DeviceCommandError(f"Failed to read vertical scale for channel {channel}.") from e
+
     def set_vertical_position(self, channel: int, offset: float) -> None:
         try:
             command = f"CH{channel}:POSition {offset:g}"
@@ -266,6 +301,12 @@ class TDS3054C(Oscilloscope):
             raise DeviceCommandError("Failed to set horizontal offset.") from e
         
 
+    def get_horizontal_scale(self) -> float:
+        try:
+            return float(self.query("HORizontal:MAIn:SCAle?"))
+        except (DeviceCommandError, ValueError) as e:
+            raise DeviceCommandError("Failed to read horizontal scale.") from e
+
     def get_horizontal_increment(self) -> float:
         try:
             command = f"WFMPre:XINcr?"
@@ -307,6 +348,103 @@ class TDS3054C(Oscilloscope):
             raise DeviceCommandError("Failed to configure trigger settings.") from e
         
 
+    def set_sampling_mode(self, mode: str, count: int) -> None:
+        try:
+            if mode == "AVERAGE":
+                if count not in self.AVERAGE_COUNTS:
+                    raise InvalidParameterError(f"Average count must be one of {self.AVERAGE_COUNTS}, given {count}")
+                self.write(f"ACQ:NUMAVG {count}")
+            elif mode == "ENVELOPE":
+                if not 1 <= count <= self.MAX_ENVELOPE_COUNT:
+                    raise InvalidParameterError(f"Envelope count must be 1-{self.MAX_ENVELOPE_COUNT}, given {count}")
+                self.write(f"ACQ:NUMENV {count}")
+            elif mode != "SAMPLE":
+                raise InvalidParameterError(f"Unknown sampling mode {mode}")
+            self.sampling_mode = mode
+            print(f"[TDS3054C] Sampling mode: {mode}" + (f" of {count}" if mode != "SAMPLE" else ""))
+        except DeviceCommandError as e:
+            raise DeviceCommandError("Failed to set the sampling mode.") from e
+
+    def get_sampling_mode(self) -> tuple:
+        try:
+            mode = self.query("ACQ:MODE?").strip().upper()
+            for name in ("SAMPLE", "AVERAGE", "ENVELOPE"):
+                if mode and name.startswith(mode[:3]):
+                    mode = name
+            if mode == "AVERAGE":
+                return mode, int(self.query("ACQ:NUMAVG?"))
+            if mode == "ENVELOPE":
+                return mode, int(self.query("ACQ:NUMENV?"))
+            return mode, 1
+        except (DeviceCommandError, ValueError) as e:
+            raise DeviceCommandError("Failed to read the sampling mode.") from e
+
+    def read_settings(self) -> dict:
+        '''
+        Channel, horizontal, trigger and acquisition settings in one round trip (SETTINGS_QUERY), parsed
+        and, under 'answers', as the scope answered them.
+        '''
+        try:
+            fields = [field.strip() for field in self.query(self.SETTINGS_QUERY).replace('\n', '').split(';')]
+            if len(fields) != 21:
+                raise ParsingError(f"Settings readback has {len(fields)} fields, expected 21.")
+            select, values = fields[:10], fields[10:]
+            mode = values[8].upper()
+            for name in ("SAMPLE", "AVERAGE", "ENVELOPE"):
+                if mode and name.startswith(mode[:3]):
+                    mode = name
+            return {
+                "channels": {str(ch): {"enabled": select[ch - 1] == "1", "scale": float(values[ch - 1])} for ch in range(1, 5)},
+                "horizontal": {"scale": float(values[4])},
+                "trigger": {"source": values[5].upper(), "slope": values[6].upper(), "level": float(values[7])},
+                # NUMENV may answer INFINITE
+                "acquisition": {"mode": mode, "numavg": int(values[9]),
+                                "numenv": int(values[10]) if values[10].isdigit() else values[10].upper()},
+                # The scope's own strings, so the server answers mirrored queries exactly as it would.
+                "answers": {
+                    "channels": {str(ch): {"enabled": select[ch - 1], "scale": values[ch - 1]} for ch in range(1, 5)},
+                    "horizontal": {"scale": values[4]},
+                    "trigger": {"source": values[5], "slope": values[6], "level": values[7]},
+                    "acquisition": {"mode": values[8], "numavg": values[9], "numenv": values[10]},
+                },
+            }
+        except (DeviceCommandError, ParsingError, ValueError) as e:
+            raise DeviceCommandError("Failed to read the settings back.") from e
+
+    def save_setup(self, slot: int) -> None:
+        try:
+            if slot not in self.SETUP_SLOTS:
+                raise InvalidParameterError(f"Setup slot must be {self.SETUP_SLOTS[0]}-{self.SETUP_SLOTS[-1]}, given {slot}")
+            self.write(f"*SAV {slot}")
+            print(f"[TDS3054C] Executed: *SAV {slot}")
+        except DeviceCommandError as e:
+            raise DeviceCommandError("Failed to save the setup.") from e
+
+    def recall_setup(self, slot: int) -> None:
+        try:
+            if slot not in self.SETUP_SLOTS:
+                raise InvalidParameterError(f"Setup slot must be {self.SETUP_SLOTS[0]}-{self.SETUP_SLOTS[-1]}, given {slot}")
+            self.write(f"*RCL {slot}")
+            # One round trip instead of a query per setting: *OPC? answers once the recall is done.
+            self.query("*OPC?")
+            self.sampling_mode = None
+            print(f"[TDS3054C] Executed: *RCL {slot}")
+        except DeviceCommandError as e:
+            raise DeviceCommandError("Failed to recall the setup.") from e
+
+    def set_data_window(self, start: int, stop: int) -> None:
+        try:
+            if start <= 0:
+                start, stop = 1, self.MAX_RECORD_LENGTH
+            elif stop < start or stop > self.MAX_RECORD_LENGTH:
+                raise InvalidParameterError(f"Invalid data window {start}..{stop}")
+            # DATA:START/STOP apply to every DATA:SOURCE, so one pair covers all channels.
+            self.write(f"DATA:START {start}")
+            self.write(f"DATA:STOP {stop}")
+            print(f"[TDS3054C] Executed: DATA:START {start}; DATA:STOP {stop}")
+        except DeviceCommandError as e:
+            raise DeviceCommandError("Failed to set the data window.") from e
+
     def get_waveform(self, channel:int, dataformat: str = 'ASCII') -> str: 
         '''
         Reads all data points from current acquisition. Dataformat defines what type of data will be returned by oscilloscope and method.
@@ -364,11 +502,14 @@ class TDS3054C(Oscilloscope):
         except (DeviceCommandError, ValueError) as e:
             raise DeviceCommandError(f"Failed to get waveform from channel {channel}.") from e
         
-    def sample(self, timeout: int = 60) -> bool:
+    def sample(self, timeout: int = 60, poll_interval: float = 0.01, should_abort=None) -> bool:
         '''
         Runs oscilloscope in single sequence mode and waits for a single acquistion -- has timeout feature. If you want to turn off the timeout set it to None
+        BUSY? is queried every poll_interval seconds while waiting; should_abort(), if given, right before.
         '''
         try:
+            phase_start = time.monotonic()
+            self.last_sample_phases = {}
 
             # Set oscilloscope into single sequence mode
             # ============================================
@@ -376,14 +517,20 @@ class TDS3054C(Oscilloscope):
             self.write("ACQ:STATE STOP")
             # 2. Turn on stop after single sequence
             self.write("ACQ:STOPA SEQ")
-            # 3. Acquire data only on one sample
-            self.write("ACQ:MODE SAMPLE")
+            # 3. Acquire one sample, or an average/envelope of NUMAVG/NUMENV triggers
+            #    (with STOPA SEQ the scope stops once the whole average is complete)
+            if self.sampling_mode is not None:
+                self.write(f"ACQ:MODE {self.sampling_mode}")
 
             print("Starting acquisition")
+            armed = time.monotonic()
+            self.last_sample_phases["configure"] = armed - phase_start
 
             # Get the samples
             # ============================================
             self.write("ACQ:STATE ON")
+            waiting = time.monotonic()
+            self.last_sample_phases["arm"] = waiting - armed
             
             # Variable for checking timeout
             start_sample = time.time()
@@ -395,16 +542,26 @@ class TDS3054C(Oscilloscope):
             while(curr_sample - start_sample < timeout):
                 curr_sample = time.time()
 
-                # Check oscilloscope state every 10ms
-                if ((curr_sample - start_sample)*100 > query_no): 
+                # Check oscilloscope state every poll_interval
+                if (curr_sample - start_sample) > query_no * poll_interval:
                     query_no += 1
+                    if should_abort is not None and should_abort():
+                        self.write("ACQ:STATE STOP")
+                        self.last_sample_phases["wait_for_trigger"] = time.monotonic() - waiting
+                        raise AcquisitionAbortedError("Acquisition stopped while waiting for a trigger.")
                     state = self.query("BUSY?")
                     # Oscilloscope no longer busy = finished acq
                     if int(state) == 0:
                         # ACQ correct
+                        self.last_sample_phases["wait_for_trigger"] = time.monotonic() - waiting
                         return
+                else:
+                    # Sleep until the next check instead of spinning on the clock
+                    elapsed = curr_sample - start_sample
+                    time.sleep(max(0.0, min(query_no * poll_interval, timeout) - elapsed))
             
             # If no signal was caught
+            self.last_sample_phases["wait_for_trigger"] = time.monotonic() - waiting
             raise AcquisitionTimeoutError(f"Acquisition timed out after {timeout} seconds.")
         
         except (DeviceCommandError, ValueError) as e:
@@ -2,6 +2,7 @@ from PySide6.QtCore import QObject, QThread, Signal, Slot
 import zmq
 import logging
 import json
+import numpy as np
 
 
 class GuiCommunicator(QObject):
@@ -36,8 +37,9 @@ class GuiCommunicator(QObject):
         while self._is_running:
             try:
                 # Block until a message is received
-                topic = sub_socket.recv_string()
-                payload = sub_socket.recv_string() # Assuming logs are strings now
+                parts = sub_socket.recv_multipart()
+                topic = parts[0].decode()
+                payload = parts[1].decode() # Assuming logs are strings now
                 # For debug
                 #print(f"--- GUI LISTENER RECEIVED: Topic='{topic}', Payload='{payload}' ---")
 
@@ -51,8 +53,8 @@ class GuiCommunicator(QObject):
                     # This topic can be used for critical errors that need special handling
                     self.error_received.emit(payload)
                 elif topic == "waveform":
-                    # Waveform data is JSON
-                    self.waveform_received.emit(json.loads(payload))
+                    # A JSON header followed by one binary float64 frame per channel
+                    self.waveform_received.emit(self._decode_waveforms(payload, parts[2:]))
 
             except zmq.Again:
                 # This is not an error, it's just the timeout.
@@ -71,6 +73,14 @@ class GuiCommunicator(QObject):
         # DO NOT terminate the context here, the ServerManager owns it.
         logging.info("GUI Communicator loop finished.")
 
+    @staticmethod
+    def _decode_waveforms(header_json: str, frames: list) -> dict:
+        """Rebuilds {'time_increment': float, 'waveforms': {channel: ndarray}} from a binary waveform message."""
+        header = json.loads(header_json)
+        dtype = np.dtype(header.get("dtype", "<f8"))
+        waveforms = {channel: np.frombuffer(frame, dtype=dtype) for channel, frame in zip(header["channels"], frames)}
+        return {"time_increment": header.get("time_increment"), "waveforms": waveforms}
+
     @Slot()
     def stop(self):
         """Signals the loop to terminate."""
@@ -99,7 +99,7 @@ class PlotPanel(QWidget):
         for data_line in self.plots.values():
             data_line.clear()
             
-        time_increment = float(payload.get('time_increment', 0.0))
+        time_increment = float(payload.get('time_increment') or 0.0)
         waveform_data = payload.get('waveforms', {})
         
         # We need a valid time increment to plot
@@ -111,9 +111,8 @@ class PlotPanel(QWidget):
 
             if channel_key in waveform_data:
                 # --- THIS IS THE CRITICAL FIX ---
-                # 1. Convert the incoming list of y-points to a NumPy array.
-                #    Explicitly set the data type to float64 for robustness.
-                y_points = np.array(waveform_data[channel_key], dtype=np.float64)
+                # 1. The y-points arrive as a float64 NumPy array decoded from the binary frame.
+                y_points = np.asarray(waveform_data[channel_key], dtype=np.float64)
 
                 # 2. Create the x-axis points as a NumPy array directly.
                 #    This is more efficient than a list comprehension.
@@ -0,0 +1,110 @@
+import math
+from collections import deque
+
+
+class AdaptiveTimeout:
+    """
+    Per-acquisition timeout and BUSY? poll interval, estimated from the timebase and a rolling
+    histogram of the observed trigger intervals.
+
+    Every acquisition contributes its wait for trigger divided by the number of triggers it needed
+    (NUMAVG/NUMENV), so one histogram serves all sampling modes. The bins are log-spaced, which keeps
+    the relative resolution the same from microsecond records to minute-long trigger gaps.
+    """
+    BINS_PER_OCTAVE = 4
+    FIRST_EDGE_S = 1e-4                 # Upper edge of the first bin
+    BIN_COUNT = 24 * BINS_PER_OCTAVE    # Up to ~1700 s
+    WINDOW = 256                        # Acquisitions kept in the histogram
+    MIN_OBSERVATIONS = 8                # Below this only the timebase and max_s are used
+    SAFETY_FACTOR = 3.0                 # Timeout = factor x the p99 interval
+    OVERHEAD_S = 0.5                    # Arming and the final BUSY? through the web interface
+    POLLS_PER_WAIT = 10                 # BUSY? polls during a median wait
+
+    def __init__(self, min_s: float = 1.0, max_s: float = 200.0, min_poll_s: float = 0.01, max_poll_s: float = 0.5):
+        self.min_s = min_s
+        self.max_s = max_s
+        self.min_poll_s = min_poll_s
+        self.max_poll_s = max_poll_s
+        self.record_time_s = None       # 10 divisions of the timebase, if known
+        self.triggers = 1               # Triggers per acquisition
+        self.counts = [0] * self.BIN_COUNT
+        self.window = deque()
+        self.timeouts = 0
+
+    def set_acquisition(self, record_time_s, triggers: int):
+        """A new timebase or average count makes the past intervals meaningless: start over."""
+        if record_time_s != self.record_time_s or triggers != self.triggers:
+            self.record_time_s = record_time_s
+            self.triggers = max(1, triggers)
+            self.counts = [0] * self.BIN_COUNT
+            self.window.clear()
+
+    def observe(self, wait_s: float, timed_out: bool = False):
+        """
+        Adds the wait for trigger of one acquisition. A timed-out wait only says the interval is longer,
+        but counting it at its length still lets the timeout grow until triggers are caught or it reaches max_s.
+        """
+        if timed_out:
+            self.timeouts += 1
+        index = self._bin(wait_s / self.triggers)
+        self.counts[index] += 1
+        self.window.append(index)
+        if len(self.window) > self.WINDOW:
+            self.counts[self.window.popleft()] -= 1
+
+    def _bin(self, interval_s: float) -> int:
+        if interval_s <= self.FIRST_EDGE_S:
+            return 0
+        index = math.ceil(math.log2(interval_s / self.FIRST_EDGE_S) * self.BINS_PER_OCTAVE)
+        return min(index, self.BIN_COUNT - 1)
+
+    def _edge(self, index: int) -> float:
+        return self.FIRST_EDGE_S * 2 ** (index / self.BINS_PER_OCTAVE)
+
+    def quantile(self, q: float):
+        """Upper bin edge below which a fraction q of the intervals lies; None without enough data."""
+        if len(self.window) < self.MIN_OBSERVATIONS:
+            return None
+        needed = q * len(self.window)
+        total = 0
+        for index, count in enumerate(self.counts):
+            total += count
+            if total >= needed:
+                return self._edge(index)
+        return self._edge(self.BIN_COUNT - 1)
+
+    def _clamp(self, value: float, low: float, high: float) -> float:
+        return min(max(value, low), high)
+
+    def timeout_s(self) -> float:
+        p99 = self.quantile(0.99)
+        if p99 is None:
+            # Nothing learned yet: never abort a slow trigger that was caught before.
+            return self.max_s
+        per_trigger = max(p99, self.record_time_s or 0.0)
+        return self._clamp(self.SAFETY_FACTOR * self.triggers * per_trigger + self.OVERHEAD_S, self.min_s, self.max_s)
+
+    def expected_s(self):
+        p50 = self.quantile(0.5)
+        if p50 is None:
+            return self.triggers * self.record_time_s if self.record_time_s else None
+        return self.triggers * max(p50, self.record_time_s or 0.0)
+
+    def poll_s(self) -> float:
+        expected = self.expected_s()
+        if expected is None:
+            return self.min_poll_s
+        return self._clamp(expected / self.POLLS_PER_WAIT, self.min_poll_s, self.max_poll_s)
+
+    def status(self) -> dict:
+        return {
+            "timeout_s": round(self.timeout_s(), 4),
+            "poll_s": round(self.poll_s(), 4),
+            "expected_s": self.expected_s(),
+            "p50_s": self.quantile(0.5),
+            "p99_s": self.quantile(0.99),
+            "record_time_s": self.record_time_s,
+            "triggers": self.triggers,
+            "observations": len(self.window),
+            "timeouts": self.timeouts,
+        }
@@ -1,9 +1,34 @@
+import json
 import logging
+import os
+import time
+import uuid
 from enum import Enum, auto
 from zmq_server.manager.device_manager import DeviceManager
 from zmq_server.common.exceptions import *
-from zmq_server.manager.zmq_manager import ZMQCommunicator, ZmqLogHandler
-from zmq_server.common.constants import Command, AcquistionMode
+from zmq_server.manager.zmq_manager import ZMQCommunicator, ZmqLogHandler, monotonic_ns
+from zmq_server.manager.sequencer import Sequencer, parse_program
+from zmq_server.manager.acquisition_timeout import AdaptiveTimeout
+from zmq_server.manager.heartbeat import HeartbeatThread
+from zmq_server.manager.command_queue import CommandQueue
+from zmq_server.common.constants import Command, Control, AcquistionMode, SamplingMode
+
+# Poll period (ms) while continuous acquisition has nothing to acquire for, or no credit to publish with.
+NO_DEMAND_POLL_MS = 100
+
+# Out of credit for this long without a new grant, the grants are taken as lost (e.g. a server restart).
+CREDIT_TIMEOUT_S = 5.0
+
+# A device request running for longer than this stops the heartbeats, so the server fails over.
+HEARTBEAT_HANG_S = 2.0
+
+# Period of the settings readback for the server's mirror (SCOPE/SETTINGS), while idle or acquiring continuously.
+SETTINGS_READBACK_S = 10.0
+# Set commands after which the next readback is taken at once: the mirror only answers RAW queries
+# with the scope's own strings, and forgets the changed one until then.
+READBACK_AFTER = {Command.SET_CHANNEL_ENABLED, Command.SET_CHANNEL_SCALE, Command.SET_TRIGGER_CHANNEL,
+                  Command.SET_TRIGGER_SLOPE, Command.SET_TRIGGER_LEVEL, Command.SET_ACQUISITION_TIMEDIV,
+                  Command.SET_ACQUISITION_SAMPLING}
 
 # This Enum defines the possible operational states of the worker.
 class WorkerState(Enum):
@@ -11,6 +36,7 @@ class WorkerState(Enum):
     BUSY = auto()
     CONTINUOUS_ACQUISITION = auto()
     SINGLE = auto()
+    SEQUENCE = auto()
 
 class BackendWorker:
     """
@@ -21,17 +47,69 @@ class BackendWorker:
         self.manager = manager
         self.state = WorkerState.IDLE
         self.device_profile = device_profile
+        # Which of the DIM server's instruments this backend is (SCOPE<n>/ with several); the server
+        # checks it at the handshake. The DIM endpoints must be that instrument's ports.
+        self.instrument = int(config.get('instrument', 1))
+
+        # Failover: a 'standby' backend only answers heartbeats until the server promotes it. Its
+        # PUB endpoint cannot be the active one's, so it tells the server where to connect.
+        self.backend_id = uuid.uuid4().hex[:12]
+        self.standby = bool(config.get('standby', False))
+        self.publish_connect_endpoint = config.get('dim_publish_connect_endpoint')
+        self.dim_router_endpoint = config.get('dim_router_endpoint')
+        self.heartbeat_hang_s = float(config.get('heartbeat_hang_s', HEARTBEAT_HANG_S))
+        self.heartbeat = None
 
         # Flags and acq settings
-        self.timeout_period = 200
+        self.timeout_period = None  # Fixed acquisition timeout (s) set with SET_TIMEOUT; None adapts it
+        self.acq_timeout = AdaptiveTimeout(min_s=float(config.get('timeout_min_s', 1.0)),
+                                           max_s=float(config.get('timeout_max_s', 200.0)))
+        self.horizontal_scale = None    # s/div: None until read, 0.0 if the driver cannot read it
         self.ignore_timeout = False
+        self.window_start = 1       # First sample transferred (1-based); set with SET_WINDOW
+        self.sampling = {"mode": SamplingMode.SAMPLE.value, "count": 1}   # Set with SET_SAMPLING
+        self.channel_scales = {}    # Volts/div per channel, sent in the waveform header for the server's auto-range
+
+        # Settings readback (one consolidated query) sent to the server's settings mirror. Due at
+        # once after anything that may change settings the server cannot follow (raw writes, recalls,
+        # sequences); 0 disables it.
+        self.settings_readback_s = float(config.get('settings_readback_s', SETTINGS_READBACK_S))
+        self.next_settings_readback = 0.0
+
+        # Mirror of the instrument's *SAV slots: the cached settings at save time, so a recall restores
+        # the cache instead of reading every setting back. Kept in 'setup_slots_path' if configured,
+        # since the slots outlive the backend.
+        self.setup_slots_path = config.get('setup_slots_path')
+        self.setup_slots = self._load_setup_slots()
+
+        # Duty-cycle accounting (backend_timing topic)
+        self.cycle_counter = 0
+        self.last_cycle_end = None
+
+        # Sequencer (run_sequence): the running program, if any
+        self.sequencer = None
+        self.sequence_counter = 0
+        self.applying_sequence_step = False
+
+        # Channels some DIM client reads, as pushed by the server; None (no message yet) means all.
+        self.wanted_channels = None
+
+        # Credit flow control (grant_credit): the last grant, None (no grant yet) means unlimited.
+        self.credit = None
+        self.frames_sent = 0            # Waveform frames published to DIM, counted like the server's 'consumed'
+        self.out_of_credit_since = None
+        self.credit_stats = {"paused": 0, "skipped": 0, "expired": 0}
+
+        # Commands received and not processed yet, in order with stops moved up (see CommandQueue). Filled
+        # between channel transfers too, so a stop ends an acquisition cycle early.
+        self.commands = CommandQueue()
         
         # The worker owns a communicator instance to handle all ZMQ logic.
         self.comm = ZMQCommunicator(config)
 
         # ZMQ logs 
         root_logger = logging.getLogger()
-        zmq_handler = ZmqLogHandler(self.comm.gui_pub_socket)
+        zmq_handler = ZmqLogHandler(self.comm)
         formatter = logging.Formatter('%(asctime)s - %(levelname)s - %(message)s')
         zmq_handler.setFormatter(formatter)
 
@@ -54,9 +132,19 @@ class BackendWorker:
             Command.SET_ACQUISITION_TIMEOUT: self._handle_set_timeout_period,
             Command.SET_ACQUISITION_IGNORE: self._handle_set_ignore_timeout,
             Command.SET_ACQUISITION_MODE: self._handle_set_acq_mode,
+            Command.SET_ACQUISITION_WINDOW: self._handle_set_window,
+            Command.SET_ACQUISITION_SAMPLING: self._handle_set_sampling,
+            Command.RUN_SEQUENCE: self._handle_run_sequence,
+            Command.SAVE_SETUP: self._handle_save_setup,
+            Command.RECALL_SETUP: self._handle_recall_setup,
             Command.RAW_QUERY: self._handle_raw_query,
             Command.RAW_WRITE: self._handle_raw_write,
         }
+        self.CONTROL_MAP = {
+            Control.SET_WANTED_CHANNELS: self._handle_set_wanted_channels,
+            Control.GRANT_CREDIT: self._handle_grant_credit,
+            Control.PROMOTE: self._handle_promote,
+        }
         logging.info("BackendWorker initialized.")
 
     def run(self):
@@ -65,34 +153,52 @@ class BackendWorker:
         by processing and replying immediately within the appropriate scope,
         which prevents the 'NameError'.
         """
-        logging.info("Sending handshake to DIM server...")
-        self.comm.reply_to_dim({"type": "handshake", "payload": "Python client online"})
+        logging.info(f"Sending handshake to DIM server as {'standby' if self.standby else 'active'} backend {self.backend_id}...")
+        handshake = {"type": "handshake", "instrument": self.instrument, "backend": self.backend_id,
+                     "role": "standby" if self.standby else "primary", "payload": "Python client online"}
+        if self.publish_connect_endpoint:
+            handshake["publish_endpoint"] = self.publish_connect_endpoint
+        self.comm.send_to_dim(handshake)
+        if self.dim_router_endpoint:
+            self.heartbeat = HeartbeatThread(self.comm.context, self.dim_router_endpoint,
+                                             {"backend": self.backend_id, "instrument": self.instrument}, self._healthy)
+            self.heartbeat.start()
+        if not self.standby:
+            self._publish_setup_slots()
         
         while True:
             try:
-                # Set a non-blocking poll timeout when in continuous mode, otherwise wait.
-                poll_timeout = 0 if self.state == WorkerState.CONTINUOUS_ACQUISITION else None
-                sockets_with_data = self.comm.poll(poll_timeout)
+                sockets_with_data = self.comm.poll(self._poll_timeout())
+                if self.heartbeat is not None and self.heartbeat.stuck_for_s is not None:
+                    logging.warning(f"A device request was stuck for {self.heartbeat.stuck_for_s:.1f} s; the DIM server saw no heartbeats meanwhile.")
+                    self.heartbeat.stuck_for_s = None
 
                 # --- Process incoming commands from the DIM Server ---
-                # The code inside this 'if' block only runs when a message is received from DIM.
+                # Everything waiting is taken, and taken again after every command, so a stop
+                # received behind a burst of settings is the next one processed.
                 if self.comm.dim_socket in sockets_with_data:
-                    # Step 1: Receive a request from DIM. 'request' is defined here.
-                    request = self.comm.receive_from_dim()
-                    
-                    # Step 2: Process it immediately to get a reply.
-                    reply = self._dispatch_request(request)
-                    
-                    # Step 3: Send the reply back to DIM.
+                    self._receive_from_dim()
+                while self.commands:
+                    reply = self._dispatch_request(self.commands.pop())
                     self.comm.reply_to_dim(reply)
+                    self._receive_from_dim()
+
+                # --- Settings readback for the server's mirror, after the commands it follows ---
+                if self._settings_readback_wanted() and time.monotonic() >= self.next_settings_readback:
+                    self._read_back_settings()
 
                 # --- Handle Continuous Acquisition State ---
                 # This runs only if no stop command was received in this loop iteration.
                 if self.state == WorkerState.CONTINUOUS_ACQUISITION:
-                    self._perform_one_acquisition_cycle()
+                    if self._acquisition_wanted() and self._credit_ok():
+                        self._perform_one_acquisition_cycle()
                 elif self.state == WorkerState.SINGLE:
                     self._perform_one_acquisition_cycle() 
                     self.set_state(WorkerState.IDLE)
+                elif self.state == WorkerState.SEQUENCE:
+                    # A sequence waits for credit rather than skip frames of its steps.
+                    if self._credit_ok():
+                        self._perform_sequence_frame()
 
             except KeyboardInterrupt:
                 logging.info("Shutdown signal received. Exiting...")
@@ -103,6 +209,9 @@ class BackendWorker:
                 self.comm.publish_to_gui("error", f"Critical error: {e}. Returning to IDLE.")
         
         # Cleanly shut down all ZMQ resources before exiting.
+        if self.heartbeat is not None:
+            self.heartbeat.stop()
+            self.heartbeat.join()
         self.comm.stop()
 
     def _dispatch_request(self, request: dict) -> dict:
@@ -123,6 +232,8 @@ class BackendWorker:
 
             if self.state == WorkerState.BUSY:
                 raise PermissionError("Device is busy with a previous command.")
+            if self.state == WorkerState.SEQUENCE and command_enum != Command.SET_ACQUISITION_MODE:
+                raise PermissionError("A sequence is running; set the mode to OFF to abort it.")
 
             # --- Look up the handler using the Enum member ---
             handler = self.COMMAND_MAP.get(command_enum)
@@ -134,19 +245,123 @@ class BackendWorker:
 
             result = handler(params)
             reply = {"status": "ok", "payload": result if result is not None else "Success"}
+            if command_enum in READBACK_AFTER:
+                self.next_settings_readback = 0.0
 
         except ValueError:
             # This block now catches invalid command strings from the Enum conversion.
             reply = {"status": "error", "message": f"Unknown command: '{command_str}'"}
-        except PermissionError as e:
+        except (PermissionError, InvalidParameterError) as e:
             reply = {"status": "error", "message": str(e)}
         except Exception as e:
             logging.critical(f"Error processing command '{command_str}': {e}", exc_info=True)
             reply = {"status": "error", "message": f"Internal Python error: {e}"}
 
+        # Echo the request id so the server can match the reply to its command.
+        if "id" in request:
+            reply["id"] = request["id"]
+
         logging.debug(f"Returning reply for '{command_str}': {reply}")
         return reply
 
+    def _poll_timeout(self):
+        """
+        Non-blocking while there is a frame to acquire, otherwise wait for a command. With no channel
+        wanted or no credit there is nothing to do either, so wait for demand or a grant instead of spinning.
+        """
+        if self.state == WorkerState.SEQUENCE:
+            return 0 if self._credit_ok() else NO_DEMAND_POLL_MS
+        timeout = None
+        if self.state == WorkerState.CONTINUOUS_ACQUISITION:
+            timeout = 0 if self._acquisition_wanted() and self._credit_ok() else NO_DEMAND_POLL_MS
+        if self._settings_readback_wanted():
+            # Wake up for the next settings readback.
+            until_readback = max(0, int((self.next_settings_readback - time.monotonic()) * 1000))
+            timeout = until_readback if timeout is None else min(timeout, until_readback)
+        return timeout
+
+    def _available_credit(self):
+        """Waveform frames that may still be published to DIM; None without flow control."""
+        if self.credit is None:
+            return None
+        return self.credit["consumed"] + self.credit["window"] - self.frames_sent
+
+    def _credit_ok(self) -> bool:
+        """True if an acquisition now can publish at least one frame to DIM (or publishes none there)."""
+        available = self._available_credit()
+        if available is None or available > 0 or self.wanted_channels == set():
+            self.out_of_credit_since = None
+            return True
+        now = time.monotonic()
+        if self.out_of_credit_since is None:
+            self.out_of_credit_since = now
+            self.credit_stats["paused"] += 1
+        elif now - self.out_of_credit_since > CREDIT_TIMEOUT_S:
+            logging.warning(f"No credit granted for {CREDIT_TIMEOUT_S} s; publishing without flow control until the next grant.")
+            self.credit_stats["expired"] += 1
+            self.credit = None
+            self.out_of_credit_since = None
+            return True
+        return False
+
+    def _healthy(self) -> bool:
+        """False while a device request has been running for over heartbeat_hang_s (heartbeat thread)."""
+        age = self.manager.device_call_age()
+        return age is None or age < self.heartbeat_hang_s
+
+    def _settings_readback_wanted(self) -> bool:
+        """Readbacks are enabled, and taken while idle or between continuous cycles; not by a standby."""
+        return (self.settings_readback_s > 0 and not self.standby
+                and self.state in (WorkerState.IDLE, WorkerState.CONTINUOUS_ACQUISITION))
+
+    def _read_back_settings(self):
+        """Reads the settings in one go and sends them to the server's mirror on the DEALER, behind the replies."""
+        self.next_settings_readback = time.monotonic() + self.settings_readback_s
+        try:
+            settings = self.manager.read_settings()
+        except Exception as e:
+            logging.warning(f"Settings readback failed: {e}")
+            return
+        if settings is None:
+            logging.info("The driver cannot read its settings back; SCOPE/SETTINGS only follows the set commands.")
+            self.settings_readback_s = 0
+            return
+        # The same values refresh the scale caches.
+        self.channel_scales.update({int(ch): channel["scale"] for ch, channel in settings["channels"].items()})
+        self.horizontal_scale = settings["horizontal"]["scale"]
+        self.comm.send_to_dim({"type": "settings", "settings": settings})
+
+    def _acquisition_wanted(self) -> bool:
+        """True if some DIM client or a GUI reads the waveforms."""
+        return self.wanted_channels != set() or self.comm.gui_wants("waveform")
+
+    def _receive_from_dim(self):
+        """
+        Takes every message waiting on the DIM socket without blocking: control messages are applied
+        at once, commands are queued (see CommandQueue).
+        """
+        while self.comm.dim_message_waiting():
+            request = self.comm.receive_from_dim()
+            if request.get("type") == "control":
+                # Control messages change worker settings and expect no reply.
+                self._dispatch_control(request)
+            else:
+                self.commands.push(request)
+
+    def _stop_requested(self) -> bool:
+        """True if a stop (mode OFF) is waiting; checked between the steps of an acquisition cycle."""
+        self._receive_from_dim()
+        return self.commands.stop_pending()
+
+    def _dispatch_control(self, request: dict):
+        """Applies a control message from the server. Errors are logged, since there is no reply."""
+        command_str = request.get("command")
+        try:
+            handler = self.CONTROL_MAP[Control(command_str)]
+            handler(request.get("params", {}))
+        except Exception as e:
+            logging.error(f"Ignoring control message '{command_str}': {e}")
+
     def _handle_raw_query(self, params: dict) -> str:
         """Handles a raw query command by executing it through the manager."""
         query_string = params.get('query')
@@ -160,11 +375,18 @@ class BackendWorker:
         command_string = params.get('command')
         if not command_string:
             raise ValueError("Parameter 'command' is required for raw_write.")
+        # A raw write may change any setting; read the scales again on the next frame.
+        self.channel_scales.clear()
+        self.horizontal_scale = None
+        self.next_settings_readback = 0.0
         # The manager's execute method handles writes as well
         return self._execute_blocking_task(self.manager.execute_raw_command, command_string)
     
     def _execute_blocking_task(self, func, *args, **kwargs):
         """A safe wrapper for tasks that ensures state is managed correctly."""
+        if self.applying_sequence_step:
+            # The sequencer owns the state while it applies a step; it must stay SEQUENCE.
+            return func(*args, **kwargs)
         self.set_state(WorkerState.BUSY)
         try:
             result = func(*args, **kwargs)
@@ -175,50 +397,132 @@ class BackendWorker:
     def set_state(self, new_state: WorkerState):
         """Changes state and publishes the update to the GUI."""
         if self.state == new_state: return
+        if self.state == WorkerState.SEQUENCE and self.sequencer is not None:
+            # Left through a stop command, a timeout or an error rather than by completing.
+            self._finish_sequence("aborted")
         self.state = new_state
+        if new_state == WorkerState.IDLE:
+            # Time spent stopped is not dead time of the next run.
+            self.last_cycle_end = None
         logging.info(f"STATE CHANGE: {self.state.name}")
         self.comm.publish_to_gui("backend_state", self.state.name)
 
-    def _perform_one_acquisition_cycle(self):
-        """Acquires data and publishes it using the communicator."""
+    def _perform_one_acquisition_cycle(self) -> bool:
+        """
+        Acquires data and publishes it using the communicator. Returns False if a stop received
+        meanwhile cut the cycle short: the trigger wait, or the channels not transferred yet, are
+        given up so the stop waits for one channel transfer at most.
+        """
+        # Phase durations (ns) of this cycle, published on 'backend_timing' for the duty-cycle accounting
+        timing = {
+            "cycle": self.cycle_counter,
+            "start": monotonic_ns(),
+            "previous_end": self.last_cycle_end,
+            "timeout": False,
+            "aborted": False,
+            "phases": {"transfer": {}, "format": 0, "publish": 0, "timediv": 0},
+        }
+        phases = timing["phases"]
+        self.cycle_counter += 1
+        aborted = False
         try:
-            gui_payload = {
-                "time_increment": None,
-                "waveforms": {}
-            }
+            # The GUI payload is only collected while a GUI is subscribed; it shows every active channel.
+            gui_waveforms = {} if self.comm.gui_wants("waveform") else None
             time_div = None
+            # Otherwise only transfer the channels some DIM client reads: CURVE? is the most expensive step.
             active_channels = self.manager.active_channels()
+            if self.wanted_channels is not None and gui_waveforms is None:
+                active_channels = [ch for ch in active_channels if int(ch) in self.wanted_channels]
+
+            # Stage stamps for the latency trace header (see LatencyTracer in the C++ server)
+            trace = {"arm": monotonic_ns()}
 
             # Start Acquisition
-            self.manager.sample(self.timeout_period)
+            timeout, poll_interval = self._acquisition_timeout()
+            timing["acquisition_timeout"] = dict(self.acq_timeout.status(), timeout_s=timeout,
+                                                 mode="fixed" if self.timeout_period is not None else "adaptive")
+            self.manager.sample(timeout, poll_interval, should_abort=self._stop_requested)
+            trace["complete"] = monotonic_ns()
+            phases.update(self._sample_phases_ns())
+            self._observe_trigger_wait(timed_out=False)
 
             # 2. Loop through each active channel and sample it.
             for channel_num in active_channels:
+                if self._stop_requested():
+                    aborted = True
+                    break
+                channel_trace = dict(trace, transfer_start=monotonic_ns())
                 # This call now blocks for only one channel's worth of data.
                 waveform_data = self.manager.get_waveform(int(channel_num))
-                if time_div is None:
-                    time_div = self.manager.get_horizontal_increment()
+                channel_trace["transfer"] = monotonic_ns()
+                phases["transfer"][str(channel_num)] = channel_trace["transfer"] - channel_trace["transfer_start"]
 
                 if waveform_data is not None:
-                    # 3. Publish to DIM server immediately for this channel.
-                    dim_topic = f"waveform_ch{channel_num}"
-                    dim_payload_str = ",".join(['{:.6E}'.format(num) for num in waveform_data])
-                    self.comm.publish_to_dim(dim_topic, dim_payload_str)
-
-                    # 4. Add this channel's data to the collection for the GUI.
-                    gui_payload['waveforms'][channel_num] = waveform_data.tolist()
+                    # 3. Publish to DIM server immediately for this channel (unless only the GUI wants it).
+                    #    Out of credit the frame is dropped here, before it costs any formatting.
+                    dim_wanted = self.wanted_channels is None or int(channel_num) in self.wanted_channels
+                    available = self._available_credit()
+                    if dim_wanted and available is not None and available <= 0:
+                        self.credit_stats["skipped"] += 1
+                        dim_wanted = False
+                    if dim_wanted:
+                        dim_topic = f"waveform_ch{channel_num}"
+                        dim_payload_str = ",".join(['{:.6E}'.format(num) for num in waveform_data])
+                        channel_trace["format"] = monotonic_ns()
+                        phases["format"] += channel_trace["format"] - channel_trace["transfer"]
+                        # The header tells the server where in the record the samples start.
+                        # An envelope record holds a min,max pair per point.
+                        points = len(waveform_data)
+                        if self.sampling["mode"] == SamplingMode.ENVELOPE.value:
+                            points //= 2
+                        window = {"start": self.window_start, "stop": self.window_start + points - 1}
+                        header = {"trace": channel_trace, "window": window}
+                        if self.sampling["mode"] != SamplingMode.SAMPLE.value:
+                            header["sampling"] = self.sampling
+                        scale = self._channel_scale(int(channel_num))
+                        if scale is not None:
+                            header["scale"] = scale
+                        if self.sequencer is not None:
+                            header["sequence"] = self.sequencer.tag()
+                        self.comm.publish_to_dim(dim_topic, dim_payload_str, header)
+                        self.frames_sent += 1
+                        phases["publish"] += monotonic_ns() - channel_trace["format"]
+
+                    # 4. Keep this channel's samples for the GUI; they are sent as a binary frame.
+                    if gui_waveforms is not None:
+                        gui_waveforms[str(channel_num)] = waveform_data
                 else:
                     logging.warning(f"Received no data for active channel {channel_num}.")
+
+            if aborted:
+                raise AcquisitionAbortedError("Stop received between channel transfers.")
+
+            # WFMPre reflects the last CURVE? transfer, so read the increment once all channels are in
+            # (keeps the query out of the per-channel transfer stage).
+            if active_channels:
+                timediv_start = monotonic_ns()
+                time_div = self.manager.get_horizontal_increment()
+                phases["timediv"] = monotonic_ns() - timediv_start
             
+            publish_start = monotonic_ns()
             if time_div is not None:
                 self.comm.publish_to_dim("waveform_timediv", time_div)
-                gui_payload["time_increment"] = time_div
 
             # 5. After the loop, send one consolidated update to the GUI.
-            if gui_payload:
-                self.comm.publish_to_gui("waveform", gui_payload)
-
+            if gui_waveforms is not None:
+                self.comm.publish_waveforms_to_gui(time_div, gui_waveforms)
+            phases["publish"] += monotonic_ns() - publish_start
+
+        except AcquisitionAbortedError as e:
+            # The stop itself is processed next by the main loop.
+            aborted = True
+            timing["aborted"] = True
+            phases.update(self._sample_phases_ns())
+            logging.info(f"Acquisition cycle {timing['cycle']} given up: {e}")
         except AcquisitionTimeoutError as e:
+            timing["timeout"] = True
+            phases.update(self._sample_phases_ns())
+            self._observe_trigger_wait(timed_out=True)
             logging.error(f"Acquisition Timeout on a channel: {e}")
             self.comm.publish_to_gui("error", f"Acquisition Timeout: {e}")
 
@@ -230,6 +534,115 @@ class BackendWorker:
             logging.critical(f"Critical error in acquisition cycle: {e}", exc_info=True)
             self.comm.publish_to_gui("error", f"Error in acquisition cycle: {e}")
             self.set_state(WorkerState.IDLE)
+        finally:
+            self._publish_cycle_timing(timing)
+        return not aborted
+
+    def _channel_scale(self, channel: int):
+        """Cached volts/div of a channel; read from the scope once, then tracked through SET_SCALE."""
+        if channel not in self.channel_scales:
+            try:
+                self.channel_scales[channel] = float(self.manager.get_vertical_scale(channel))
+            except Exception as e:
+                logging.debug(f"Vertical scale of channel {channel} unknown: {e}")
+                self.channel_scales[channel] = None
+        return self.channel_scales[channel]
+
+    def _horizontal_scale(self):
+        """Cached s/div; read from the scope once, then tracked through SET_TIMEDIV."""
+        if self.horizontal_scale is None:
+            try:
+                self.horizontal_scale = float(self.manager.get_horizontal_scale())
+            except Exception as e:
+                logging.debug(f"Horizontal scale unknown: {e}")
+                self.horizontal_scale = 0.0
+        return self.horizontal_scale or None
+
+    def _acquisition_timeout(self):
+        """(timeout, BUSY? poll interval) in s for the next acquisition: SET_TIMEOUT's value, or the adaptive estimate."""
+        horizontal_scale = self._horizontal_scale()
+        record_time = 10.0 * horizontal_scale if horizontal_scale else None
+        self.acq_timeout.set_acquisition(record_time, int(self.sampling.get("count", 1)))
+        timeout = self.timeout_period if self.timeout_period is not None else self.acq_timeout.timeout_s()
+        return timeout, self.acq_timeout.poll_s()
+
+    def _observe_trigger_wait(self, timed_out: bool):
+        wait = self.manager.sample_phases().get("wait_for_trigger")
+        if wait is not None:
+            self.acq_timeout.observe(wait, timed_out)
+
+    def _perform_sequence_frame(self):
+        """Acquires the next frame of the running sequence, applying the step's commands before its first frame."""
+        sequencer = self.sequencer
+        if sequencer.frame_index == 0:
+            self._apply_sequence_commands(sequencer.step.commands)
+
+        completed = self._perform_one_acquisition_cycle()
+        if self.state != WorkerState.SEQUENCE or not completed:
+            return  # The cycle failed and ended the sequence, or a stop is about to
+
+        if sequencer.advance():
+            self._publish_sequence_progress("running")
+        else:
+            self._finish_sequence("done")
+            self.set_state(WorkerState.IDLE)
+
+    def _apply_sequence_commands(self, commands: list):
+        """Runs step commands through the regular handlers, without leaving the SEQUENCE state."""
+        self.applying_sequence_step = True
+        try:
+            for command, params in commands:
+                self.COMMAND_MAP[command](params)
+        finally:
+            self.applying_sequence_step = False
+
+    def _publish_sequence_progress(self, state: str):
+        self.comm.publish_to_dim("sequence_progress", json.dumps(self.sequencer.progress(state)))
+
+    def _finish_sequence(self, state: str):
+        """Publishes the final progress ('done' or 'aborted') and drops the program."""
+        logging.info(f"Sequence {self.sequencer.sequence_id} {state} after {self.sequencer.frames_done} frames.")
+        self._publish_sequence_progress(state)
+        self.sequencer = None
+        self.next_settings_readback = 0.0
+
+    def _sample_phases_ns(self) -> dict:
+        """Driver-side phases of the last sample() (configure, arm, wait_for_trigger) in ns."""
+        return {name: int(seconds * 1e9) for name, seconds in self.manager.sample_phases().items()}
+
+    def _publish_cycle_timing(self, timing: dict):
+        """Closes the cycle and publishes its phase durations for the server's duty-cycle accounting."""
+        timing["end"] = monotonic_ns()
+        timing["credit"] = dict(self.credit_stats, available=self._available_credit())
+        # Stays None when the cycle ended the acquisition, so the next run starts a fresh span.
+        if self.state in (WorkerState.CONTINUOUS_ACQUISITION, WorkerState.SINGLE, WorkerState.SEQUENCE):
+            self.last_cycle_end = timing["end"]
+        self.comm.publish_to_dim("backend_timing", json.dumps(timing))
+
+    # --- Control Handler Implementations ---
+
+    def _handle_grant_credit(self, params: dict) -> None:
+        consumed, window, epoch = int(params['consumed']), int(params['window']), params.get('epoch')
+        if self.credit is None or epoch != self.credit["epoch"]:
+            # A new grant sequence (first grant, restarted server, or after an expiry): nothing is in flight to it.
+            self.frames_sent = consumed
+        self.credit = {"consumed": consumed, "window": window, "epoch": epoch}
+
+    def _handle_promote(self, params: dict) -> None:
+        if not self.standby:
+            return
+        logging.warning("Promoted by the DIM server: the active backend stopped answering heartbeats.")
+        self.standby = False
+        # The instrument may have been changed by the lost backend since this one started.
+        self.channel_scales.clear()
+        self.horizontal_scale = None
+        self._publish_setup_slots()
+
+    def _handle_set_wanted_channels(self, params: dict) -> None:
+        wanted = {int(ch) for ch in params['channels']}
+        if wanted != self.wanted_channels:
+            logging.info(f"Wanted channels: {sorted(wanted) if wanted else 'none'}")
+        self.wanted_channels = wanted
 
     # --- Command Handler Implementations ---
 
@@ -240,7 +653,9 @@ class BackendWorker:
         return self._execute_blocking_task(self.manager.apply_settings, params)
     
     def _handle_set_timediv(self, params: dict) -> None:
-        return self._execute_blocking_task(self.manager.set_horizontal_scale, params['level'])
+        result = self._execute_blocking_task(self.manager.set_horizontal_scale, params['level'])
+        self.horizontal_scale = float(params['level'])
+        return result
 
     def _handle_start_continuous_acquisition(self, params: dict) -> str:
         if self.state != WorkerState.IDLE:
@@ -259,7 +674,7 @@ class BackendWorker:
           
     def _handle_stop_acquisition(self, params: dict) -> str:
             # Only stop if in a state that is actively acquiring.
-            if self.state not in [WorkerState.CONTINUOUS_ACQUISITION, WorkerState.SINGLE]:
+            if self.state not in [WorkerState.CONTINUOUS_ACQUISITION, WorkerState.SINGLE, WorkerState.SEQUENCE]:
                 return "Warning: Acquisition is not currently running."
             
             self.set_state(WorkerState.IDLE)
@@ -269,7 +684,9 @@ class BackendWorker:
         return self._execute_blocking_task(self.manager.set_channel_state, params['channel'], bool(params['enabled']))
 
     def _handle_set_channel_volts(self, params: dict) -> None:
-        return self._execute_blocking_task(self.manager.set_vertical_scale, params['channel'], float(params['scale']))
+        channel, scale = int(params['channel']), float(params['scale'])
+        self._execute_blocking_task(self.manager.set_vertical_scale, channel, scale)
+        self.channel_scales[channel] = scale
 
     def _handle_set_trigger_slope(self, params: dict) -> None:
         return self._execute_blocking_task(self.manager.set_trigger_slope, params['slope'])
@@ -281,14 +698,18 @@ class BackendWorker:
         return self._execute_blocking_task(self.manager.set_trigger_channel, int(params['channel']))
 
     def _handle_set_timeout_period(self, params: dict) -> str:
-        """Updates the acquisition timeout period."""
+        """Fixes the acquisition timeout period (s); 0 or less returns to the adaptive timeout."""
         period = params.get('level')
         if period is None:
             raise ValueError("Parameter 'period' is required.")
         
+        if float(period) <= 0:
+            self.timeout_period = None
+            logging.info("Acquisition timeout set to adaptive.")
+            return "Timeout set to adaptive."
         self.timeout_period = float(period)
-        logging.info(f"Acquisition timeout period set to {self.timeout_period} ms.")
-        return f"Timeout set to {self.timeout_period} ms."
+        logging.info(f"Acquisition timeout period set to {self.timeout_period} s.")
+        return f"Timeout set to {self.timeout_period} s."
 
     def _handle_set_ignore_timeout(self, params: dict) -> str:
         """Updates the flag to ignore timeouts in continuous mode."""
@@ -300,6 +721,96 @@ class BackendWorker:
         logging.info(f"Ignore timeout set to {self.ignore_timeout}.")
         return f"Ignore timeout set to {self.ignore_timeout}."
     
+    def _handle_run_sequence(self, params: dict) -> str:
+        """Starts a sequence program (see sequencer.parse_program); frames are acquired from the main loop."""
+        if self.state != WorkerState.IDLE:
+            raise PermissionError(f"Cannot start a sequence from the current state: {self.state.name}")
+        setup, steps = parse_program(params['program'])
+
+        self.sequence_counter += 1
+        if setup:
+            self._execute_blocking_task(self._apply_sequence_commands, setup)
+        self.sequencer = Sequencer(self.sequence_counter, steps)
+        self.set_state(WorkerState.SEQUENCE)
+        self._publish_sequence_progress("running")
+        return f"Sequence {self.sequence_counter} started: {len(steps)} steps, {self.sequencer.total_frames} frames."
+
+    def _handle_set_sampling(self, params: dict) -> str:
+        """SAMPLE, AVERAGE or ENVELOPE acquisition, done by the instrument: only the finished record is transferred."""
+        try:
+            mode = SamplingMode(str(params['mode']).upper())
+        except ValueError:
+            raise InvalidParameterError(f"Invalid sampling mode: {params['mode']}")
+        count = int(params.get('count', 1 if mode == SamplingMode.SAMPLE else 16))
+        self._execute_blocking_task(self.manager.set_sampling_mode, mode.value, count)
+        self.sampling = {"mode": mode.value, "count": count if mode != SamplingMode.SAMPLE else 1}
+        if mode == SamplingMode.SAMPLE:
+            return "Sampling mode set to SAMPLE."
+        return f"Sampling mode set to {mode.value} of {count} acquisitions."
+
+    def _handle_save_setup(self, params: dict) -> str:
+        """Stores the instrument setup in a memory slot (*SAV) and mirrors the cached settings for it."""
+        slot = int(params['slot'])
+        self._execute_blocking_task(self.manager.save_setup, slot)
+        self.setup_slots[slot] = {
+            "saved_at": time.time(),
+            "sampling": dict(self.sampling),
+            "scales": {str(ch): scale for ch, scale in self.channel_scales.items() if scale is not None},
+        }
+        self._store_setup_slots()
+        self._publish_setup_slots()
+        return f"Setup saved to slot {slot}."
+
+    def _handle_recall_setup(self, params: dict) -> str:
+        """Recalls a memory slot (*RCL). The settings cache is restored from the mirror, or re-read if the slot is unknown."""
+        slot = int(params['slot'])
+        self._execute_blocking_task(self.manager.recall_setup, slot)
+        self.channel_scales.clear()
+        self.horizontal_scale = None
+        self.next_settings_readback = 0.0
+        mirror = self.setup_slots.get(slot)
+        if mirror is not None:
+            self.channel_scales.update({int(ch): scale for ch, scale in mirror["scales"].items()})
+            self.sampling = dict(mirror["sampling"])
+            return f"Setup recalled from slot {slot}."
+        # Saved outside this backend: scales are read lazily per frame, the sampling mode now.
+        mode, count = self._execute_blocking_task(self.manager.get_sampling_mode)
+        self.sampling = {"mode": mode, "count": count}
+        return f"Setup recalled from slot {slot} (not saved through the server; settings read back)."
+
+    def _load_setup_slots(self) -> dict:
+        if not self.setup_slots_path or not os.path.exists(self.setup_slots_path):
+            return {}
+        try:
+            with open(self.setup_slots_path) as f:
+                return {int(slot): entry for slot, entry in json.load(f).items()}
+        except (OSError, ValueError, AttributeError) as e:
+            logging.warning(f"Ignoring setup slot mirror {self.setup_slots_path}: {e}")
+            return {}
+
+    def _store_setup_slots(self):
+        if not self.setup_slots_path:
+            return
+        try:
+            with open(self.setup_slots_path, 'w') as f:
+                json.dump(self.setup_slots, f, indent=2)
+        except OSError as e:
+            logging.warning(f"Could not store the setup slot mirror to {self.setup_slots_path}: {e}")
+
+    def _publish_setup_slots(self):
+        self.comm.publish_to_dim("setup_slots", json.dumps({str(slot): entry for slot, entry in sorted(self.setup_slots.items())}))
+
+    def _handle_set_window(self, params: dict) -> str:
+        """Limits the CURVE? transfer to samples start..stop of the record; start 0 restores the full record."""
+        start, stop = int(params['start']), int(params['stop'])
+        if start > 0 and stop < start:
+            raise InvalidParameterError(f"Window stop ({stop}) is before its start ({start}).")
+        self._execute_blocking_task(self.manager.set_data_window, start, stop)
+        self.window_start = max(start, 1)
+        if start <= 0:
+            return "Window reset to the full record."
+        return f"Window set to samples {start}..{stop}."
+
     def _handle_set_acq_mode(self, params: dict) -> str:
         state = params.get('state', '').upper()
         if state == AcquistionMode.CONTINUOUS.value:
@@ -0,0 +1,51 @@
+from collections import deque
+from enum import IntEnum
+
+from zmq_server.common.constants import Command, AcquistionMode
+
+
+class Priority(IntEnum):
+    """How a received command is ordered, as the server's CommandPriority (control messages are never queued)."""
+    ABORT = 0       # set_acquisition_mode OFF
+    MODE = 1        # Any other set_acquisition_mode, run_sequence
+    NORMAL = 2      # Settings, setups, raw queries and writes
+
+
+def command_priority(request: dict) -> Priority:
+    command = request.get("command")
+    if command == Command.SET_ACQUISITION_MODE.value:
+        state = str(request.get("params", {}).get("state", "")).upper()
+        return Priority.ABORT if state == AcquistionMode.OFF.value else Priority.MODE
+    if command == Command.RUN_SEQUENCE.value:
+        return Priority.MODE
+    return Priority.NORMAL
+
+
+class CommandQueue:
+    """
+    Commands received from the DIM server and not processed yet, in arrival order. A stop is moved
+    ahead of the settings queued before it, but not ahead of a mode command: CONT followed by OFF
+    still ends stopped.
+    """
+    def __init__(self):
+        self.queue = deque()    # (priority, request)
+
+    def __len__(self):
+        return len(self.queue)
+
+    def push(self, request: dict):
+        priority = command_priority(request)
+        if priority != Priority.ABORT:
+            self.queue.append((priority, request))
+            return
+        position = len(self.queue)
+        while position > 0 and self.queue[position - 1][0] == Priority.NORMAL:
+            position -= 1
+        self.queue.insert(position, (priority, request))
+
+    def pop(self) -> dict:
+        return self.queue.popleft()[1]
+
+    def stop_pending(self) -> bool:
+        """True if a stop is queued, wherever it is."""
+        return any(priority == Priority.ABORT for priority, _ in self.queue)
@@ -79,6 +79,13 @@ class DeviceManager():
             logging.error(f"Device command set_vertical_scale failed: {e}")
             raise e
         
+    def get_vertical_scale(self, channel_number: int) -> float:
+        try:
+            return self.dev.get_vertical_scale(channel_number)
+        except DeviceError as e:
+            logging.error(f"Device command get_vertical_scale failed: {e}")
+            raise e
+
     def set_horizontal_scale(self, scale: float) -> None:
         try:
             self.dev.set_horizontal_scale(scale)
@@ -86,6 +93,13 @@ class DeviceManager():
             logging.error(f"Device command set_trigger_slope failed: {e}")
             raise e
     
+    def get_horizontal_scale(self) -> float:
+        try:
+            return self.dev.get_horizontal_scale()
+        except DeviceError as e:
+            logging.error(f"Device command get_horizontal_scale failed: {e}")
+            raise e
+
     def get_horizontal_increment(self) -> float:
         try:
             return self.dev.get_horizontal_increment()
@@ -121,13 +135,74 @@ class DeviceManager():
             logging.error(f"Device command set_trigger_state failed: {e}")
             raise e
         
-    def sample(self, timeout: int) -> None:
+    def sample(self, timeout: int, poll_interval: float = 0.01, should_abort=None) -> None:
         try:
-            return self.dev.sample(timeout)
+            return self.dev.sample(timeout, poll_interval, should_abort)
         except DeviceError as e:
             logging.error(f"Device command set_channel_state failed: {e}")
             raise e
         
+    def device_call_age(self):
+        """
+        Seconds the device request in progress has been running; None between requests, or if the
+        driver does not record when its requests start (request_started).
+        """
+        started = getattr(self.dev, 'request_started', None)
+        return None if started is None else time.monotonic() - started
+
+    def read_settings(self):
+        """
+        The channel, horizontal, trigger and acquisition settings, read in one go for the DIM server's
+        settings mirror; None if the driver cannot read them back (read_settings).
+        """
+        read = getattr(self.dev, 'read_settings', None)
+        if read is None:
+            return None
+        try:
+            return read()
+        except DeviceError as e:
+            logging.error(f"Device command read_settings failed: {e}")
+            raise e
+
+    def sample_phases(self) -> dict:
+        """Durations (s) of the phases of the last sample() call, if the driver records them."""
+        return dict(getattr(self.dev, 'last_sample_phases', {}))
+
+    def set_sampling_mode(self, mode: str, count: int) -> None:
+        try:
+            self.dev.set_sampling_mode(mode, count)
+        except DeviceError as e:
+            logging.error(f"Device command set_sampling_mode failed: {e}")
+            raise e
+
+    def get_sampling_mode(self) -> tuple:
+        try:
+            return self.dev.get_sampling_mode()
+        except DeviceError as e:
+            logging.error(f"Device command get_sampling_mode failed: {e}")
+            raise e
+
+    def save_setup(self, slot: int) -> None:
+        try:
+            self.dev.save_setup(slot)
+        except DeviceError as e:
+            logging.error(f"Device command save_setup failed: {e}")
+            raise e
+
+    def recall_setup(self, slot: int) -> None:
+        try:
+            self.dev.recall_setup(slot)
+        except DeviceError as e:
+            logging.error(f"Device command recall_setup failed: {e}")
+            raise e
+
+    def set_data_window(self, start: int, stop: int) -> None:
+        try:
+            self.dev.set_data_window(start, stop)
+        except DeviceError as e:
+            logging.error(f"Device command set_data_window failed: {e}")
+            raise e
+
     def get_waveform(self, channel:int):
         try:
             return self.dev.get_waveform(channel)
@@ -0,0 +1,76 @@
+import json
+import threading
+import time
+
+import zmq
+
+from zmq_server.common.constants import Control
+
+
+class HeartbeatThread(threading.Thread):
+    """
+    Echoes the DIM server's heartbeats on a DEALER socket of its own, so they are answered while the
+    main loop waits for a trigger or transfers a curve. The echo is skipped while healthy() is False
+    (a device request stuck for too long), which makes a hung backend look as dead as a crashed one.
+
+    Until the first heartbeat arrives (server not up yet, or restarted) a hello is sent every
+    HELLO_PERIOD_S, which tells the server where to send them.
+    """
+    HELLO_PERIOD_S = 1.0
+    POLL_MS = 50
+
+    def __init__(self, context: zmq.Context, endpoint: str, identity: dict, healthy):
+        super().__init__(name="heartbeat", daemon=True)
+        self.context = context
+        self.endpoint = endpoint
+        self.identity = identity        # backend and instrument, as in the handshake
+        self.healthy = healthy
+        self.stopped = threading.Event()
+        self.last_heartbeat = None      # time.monotonic() of the last heartbeat received
+        self.unhealthy_since = None     # Since when heartbeats are not answered
+        self.stuck_for_s = None         # Length of the last such period, until the main loop reports it
+
+    def stop(self):
+        self.stopped.set()
+
+    def run(self):
+        socket = self.context.socket(zmq.DEALER)
+        socket.setsockopt(zmq.LINGER, 0)
+        socket.connect(self.endpoint)
+        last_hello = 0.0
+        try:
+            while not self.stopped.is_set():
+                if socket.poll(self.POLL_MS):
+                    socket.recv()   # Empty delimiter
+                    message = json.loads(socket.recv_string())
+                    if message.get("command") == Control.HEARTBEAT.value:
+                        self.last_heartbeat = time.monotonic()
+                        if self._check_health():
+                            params = message.get("params", {})
+                            self._send(socket, seq=params.get("seq"), sent_ns=params.get("sent_ns"))
+
+                now = time.monotonic()
+                waiting = self.last_heartbeat is None or now - self.last_heartbeat > self.HELLO_PERIOD_S
+                if waiting and now - last_hello > self.HELLO_PERIOD_S and self._check_health():
+                    self._send(socket)
+                    last_hello = now
+        finally:
+            socket.close()
+
+    def _check_health(self) -> bool:
+        # No logging here: the log handler publishes on the main thread's GUI socket. The main loop
+        # reports a stuck period once it is back (unhealthy_since / stuck_for_s).
+        healthy = self.healthy()
+        now = time.monotonic()
+        if not healthy and self.unhealthy_since is None:
+            self.unhealthy_since = now
+        elif healthy and self.unhealthy_since is not None:
+            self.stuck_for_s = now - self.unhealthy_since
+            self.unhealthy_since = None
+        return healthy
+
+    def _send(self, socket, **fields):
+        message = {"type": "heartbeat", **self.identity}
+        message.update({key: value for key, value in fields.items() if value is not None})
+        socket.send(b'', zmq.SNDMORE)
+        socket.send_json(message)
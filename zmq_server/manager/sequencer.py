@@ -0,0 +1,144 @@
+import json
+import time
+from zmq_server.common.exceptions import InvalidParameterError
+from zmq_server.common.constants import Command
+
+# Commands a program may not contain: the sequencer itself drives the acquisition.
+FORBIDDEN_COMMANDS = {Command.SET_ACQUISITION_MODE, Command.RUN_SEQUENCE}
+MAX_STEPS = 10000
+
+
+class SequenceStep:
+    """One step of a program: commands applied in order, then 'frames' acquisitions."""
+    def __init__(self, commands: list, frames: int, value=None):
+        self.commands = commands    # [(Command, params dict), ...]
+        self.frames = frames
+        self.value = value          # Swept value of this step, if the program is a sweep
+
+
+def _parse_commands(settings: dict, where: str) -> list:
+    """Converts {"set_trigger_level": {"level": 0.01}, ...} to [(Command, params), ...]."""
+    if not isinstance(settings, dict):
+        raise InvalidParameterError(f"'{where}' must map command names to their parameters.")
+    commands = []
+    for name, params in settings.items():
+        try:
+            command = Command(name)
+        except ValueError:
+            raise InvalidParameterError(f"Unknown command '{name}' in '{where}'.")
+        if command in FORBIDDEN_COMMANDS:
+            raise InvalidParameterError(f"Command '{name}' is not allowed in a sequence.")
+        if not isinstance(params, dict):
+            raise InvalidParameterError(f"Parameters of '{name}' in '{where}' must be an object.")
+        commands.append((command, params))
+    return commands
+
+
+def _parse_frames(value, where: str) -> int:
+    if not isinstance(value, int) or isinstance(value, bool) or value < 1:
+        raise InvalidParameterError(f"'frames' of {where} must be a positive integer.")
+    return value
+
+
+def parse_program(text: str):
+    """
+    Parses a sequence program. Returns (setup commands, steps).
+
+    {
+      "setup":  {"set_acquisition_timeout": {"level": 500}},            # optional, applied once
+      "frames": 10,                                                     # default frames per step
+      "steps":  [{"set": {"set_trigger_level": {"level": 0.01}}, "frames": 5}, ...],
+      "sweep":  {"command": "set_trigger_level", "param": "level",      # or a sweep instead of steps
+                 "start": 0.0, "stop": 0.05, "step": 0.01}
+    }
+    """
+    try:
+        program = json.loads(text)
+    except ValueError as e:
+        raise InvalidParameterError(f"The sequence program is not valid JSON: {e}")
+    if not isinstance(program, dict):
+        raise InvalidParameterError("The sequence program must be a JSON object.")
+
+    setup = _parse_commands(program.get("setup", {}), "setup")
+    default_frames = _parse_frames(program.get("frames", 1), "the program")
+
+    if ("steps" in program) == ("sweep" in program):
+        raise InvalidParameterError("The sequence program needs either 'steps' or 'sweep'.")
+
+    steps = []
+    if "steps" in program:
+        if not isinstance(program["steps"], list):
+            raise InvalidParameterError("'steps' must be a list.")
+        for i, step in enumerate(program["steps"]):
+            if not isinstance(step, dict):
+                raise InvalidParameterError(f"Step {i} must be an object.")
+            commands = _parse_commands(step.get("set", {}), f"steps[{i}].set")
+            steps.append(SequenceStep(commands, _parse_frames(step.get("frames", default_frames), f"step {i}")))
+    else:
+        sweep = program["sweep"]
+        try:
+            command_name, param = sweep["command"], sweep["param"]
+            start, stop, increment = float(sweep["start"]), float(sweep["stop"]), float(sweep["step"])
+        except (KeyError, TypeError, ValueError):
+            raise InvalidParameterError("'sweep' needs 'command', 'param' and numeric 'start', 'stop' and 'step'.")
+        if increment == 0 or (stop - start) / increment < 0:
+            raise InvalidParameterError("'sweep' step must move from start towards stop.")
+        count = int(round((stop - start) / increment)) + 1
+        if count > MAX_STEPS:
+            raise InvalidParameterError(f"The sweep has {count} steps, more than {MAX_STEPS}.")
+        for i in range(count):
+            value = start + i * increment
+            commands = _parse_commands({command_name: {param: value}}, "sweep")
+            steps.append(SequenceStep(commands, default_frames, value))
+
+    if not steps:
+        raise InvalidParameterError("The sequence program has no steps.")
+    if len(steps) > MAX_STEPS:
+        raise InvalidParameterError(f"The sequence program has {len(steps)} steps, more than {MAX_STEPS}.")
+    return setup, steps
+
+
+class Sequencer:
+    """
+    Position of a running program. The worker acquires one frame per main-loop iteration, so
+    commands (e.g. SET_MODE OFF to abort) are still served between frames.
+    """
+    def __init__(self, sequence_id: int, steps: list):
+        self.sequence_id = sequence_id
+        self.steps = steps
+        self.step_index = 0
+        self.frame_index = 0        # Frames acquired in the current step
+        self.total_frames = sum(step.frames for step in steps)
+        self.frames_done = 0
+        self.started = time.monotonic()
+
+    @property
+    def step(self) -> SequenceStep:
+        return self.steps[self.step_index]
+
+    def tag(self) -> dict:
+        """Identifies the frame being acquired; sent in the waveform header."""
+        tag = {"id": self.sequence_id, "step": self.step_index, "frame": self.frame_index}
+        if self.step.value is not None:
+            tag["value"] = self.step.value
+        return tag
+
+    def advance(self) -> bool:
+        """Counts one acquired frame. Returns False once the last frame of the last step is done."""
+        self.frames_done += 1
+        self.frame_index += 1
+        if self.frame_index >= self.step.frames:
+            self.frame_index = 0
+            self.step_index += 1
+        return self.step_index < len(self.steps)
+
+    def progress(self, state: str) -> dict:
+        return {
+            "id": self.sequence_id,
+            "state": state,
+            "step": min(self.step_index, len(self.steps) - 1),
+            "steps": len(self.steps),
+            "frames_done": self.frames_done,
+            "frames_total": self.total_frames,
+            "elapsed_s": round(time.monotonic() - self.started, 3),
+        }
@@ -1,26 +1,41 @@
 import zmq
 import json
 import logging
+import time
+
+# Messages queued on the PUB socket to the DIM server before ZMQ drops them (same as Constants::ZMQ_SUB_HWM)
+DIM_PUB_HWM = 64
+
+def monotonic_ns() -> int:
+    """
+    CLOCK_MONOTONIC in nanoseconds -- the same clock as std::chrono::steady_clock in the C++ server,
+    so trace stamps taken here can be compared with the server's on the same host.
+    (time.monotonic_ns() would do, but it needs Python 3.7+.)
+    """
+    return int(time.monotonic() * 1e9)
 
 class ZmqLogHandler(logging.Handler):
     """
-    A custom logging handler that publishes log records to a ZMQ PUB socket.
+    A custom logging handler that publishes log records on the communicator's GUI socket.
+    Records are only formatted and sent while a GUI subscribes to the topic.
     """
-    def __init__(self, pub_socket: zmq.Socket, topic: str = "log"):
+    def __init__(self, comm: "ZMQCommunicator", topic: str = "log"):
         super().__init__()
-        self.pub_socket = pub_socket
+        self.comm = comm
         self.topic = topic
 
     def emit(self, record: logging.LogRecord):
         """
         Formats the log record and publishes it over the ZMQ socket.
         """
+        if not self.comm.gui_wants(self.topic):
+            return
         # We use format(record) to get the full formatted string,
         # including traceback information for exceptions.
         log_message = self.format(record)
         try:
-            self.pub_socket.send_string(self.topic, zmq.SNDMORE)
-            self.pub_socket.send_string(log_message)
+            self.comm.gui_pub_socket.send_string(self.topic, zmq.SNDMORE)
+            self.comm.gui_pub_socket.send_string(log_message)
         except zmq.ZMQError as e:
             # If ZMQ fails, we can't log it through ZMQ, so print to stderr.
             import sys
@@ -40,17 +55,22 @@ class ZMQCommunicator:
         self.dim_socket = self.context.socket(zmq.DEALER)
         self.dim_socket.connect(config['dim_router_endpoint'])
 
-        # --- Socket for Publishing to the GUI (PUB) ---
-        self.gui_pub_socket = self.context.socket(zmq.PUB)
+        # --- Socket for Publishing to the GUI (XPUB) ---
+        # XPUB passes the GUI's subscriptions up to us, so nothing is built for a GUI that is not there.
+        self.gui_pub_socket = self.context.socket(zmq.XPUB)
         self.gui_pub_socket.bind(config['local_publish_bind_endpoint'])
+        self.gui_subscriptions = set()
 
         # --- Socket for Publishing to the DIM Server (PUB) ---
         self.dim_pub_socket = self.context.socket(zmq.PUB)
+        # Credit flow control keeps the waveforms well below this; the bound only matters for a dead server.
+        self.dim_pub_socket.setsockopt(zmq.SNDHWM, DIM_PUB_HWM)
         self.dim_pub_socket.bind(config['dim_publish_endpoint'])
 
         # --- Poller to manage all readable sockets ---
         self.poller = zmq.Poller()
         self.poller.register(self.dim_socket, zmq.POLLIN)
+        self.poller.register(self.gui_pub_socket, zmq.POLLIN)
 
         logging.info("ZMQCommunicator initialized with 4 sockets.")
 
@@ -58,8 +78,35 @@ class ZMQCommunicator:
         """
         Polls the sockets for incoming messages.
         Returns a dictionary of sockets that have events.
+        GUI subscription changes are consumed here and do not appear in the result.
+        """
+        sockets = dict(self.poller.poll(timeout))
+        if sockets.pop(self.gui_pub_socket, None):
+            self._update_gui_subscriptions()
+        return sockets
+
+    def _update_gui_subscriptions(self):
+        """
+        Drains the XPUB subscription messages: b'\x01<prefix>' subscribes, b'\x00<prefix>' unsubscribes.
+        XPUB only forwards the first subscription and the last unsubscription of a prefix, so a set is enough.
         """
-        return dict(self.poller.poll(timeout))
+        while True:
+            try:
+                message = self.gui_pub_socket.recv(zmq.NOBLOCK)
+            except zmq.Again:
+                break
+            if not message:
+                continue
+            prefix = message[1:].decode(errors="replace")
+            if message[0] == 1:
+                self.gui_subscriptions.add(prefix)
+            else:
+                self.gui_subscriptions.discard(prefix)
+            logging.info(f"GUI subscriptions: {sorted(self.gui_subscriptions) or 'none'}")
+
+    def gui_wants(self, topic: str) -> bool:
+        """True if a connected GUI subscribes to the topic (or to a prefix of it)."""
+        return any(topic.startswith(prefix) for prefix in self.gui_subscriptions)
 
     def receive_from_dim(self) -> dict:
         """Receives a multipart JSON message from the DIM server's ROUTER."""
@@ -70,29 +117,61 @@ class ZMQCommunicator:
         return json.loads(msg_raw)
 
 
+    def dim_message_waiting(self) -> bool:
+        """True if a message from the DIM server can be received without blocking."""
+        return bool(self.dim_socket.poll(0))
+
     def reply_to_dim(self, reply: dict):
         """Sends a multipart JSON reply to the DIM server."""
         reply['type'] = 'reply'
+        self.send_to_dim(reply)
+
+    def send_to_dim(self, message: dict):
+        """Sends a message of its own type (handshake, ...) to the DIM server's ROUTER."""
         # DEALER must send [delimiter, message] to be routed correctly
         self.dim_socket.send(b'', zmq.SNDMORE)
-        self.dim_socket.send_json(reply)
+        self.dim_socket.send_json(message)
 
     def publish_to_gui(self, topic: str, payload):
-        """Publishes a multipart message (topic, json_payload) to the GUI."""
+        """Publishes a multipart message (topic, json_payload) to the GUI, if one subscribes to the topic."""
+        if not self.gui_wants(topic):
+            return
         self.gui_pub_socket.send_string(topic, zmq.SNDMORE)
         self.gui_pub_socket.send_json(payload)
         logging.info(f"Published to GUI on topic '{topic}'")
 
-    def publish_to_dim(self, topic: str, payload: str):
+    def publish_waveforms_to_gui(self, time_increment, waveforms: dict):
+        """
+        Publishes the waveforms of one cycle to the GUI as binary frames:
+        (topic, json header, one little-endian float64 frame per channel in header['channels'] order).
+        """
+        channels = list(waveforms.keys())
+        header = {"time_increment": time_increment, "channels": channels, "dtype": "<f8"}
+        self.gui_pub_socket.send_string("waveform", zmq.SNDMORE)
+        self.gui_pub_socket.send_json(header, zmq.SNDMORE if channels else 0)
+        for i, channel in enumerate(channels):
+            frame = waveforms[channel].astype("<f8", copy=False)
+            self.gui_pub_socket.send(frame, zmq.SNDMORE if i < len(channels) - 1 else 0, copy=False)
+        logging.info("Published to GUI on topic 'waveform'")
+
+    def publish_to_dim(self, topic: str, payload: str, header: dict = None):
         """
-        Publishes a multipart message (topic, payload) to the DIM server.
+        Publishes a multipart message (topic, payload[, header]) to the DIM server.
+        The optional header is sent as a third JSON part; if it carries a 'trace' dict,
+        the 'publish' stamp is added just before sending.
         """
         # Step 1: Send the topic string, with the SNDMORE flag to indicate
         # that another part of the message is coming.
         self.dim_pub_socket.send_string(topic, zmq.SNDMORE)
         
-        # Step 2: Send the payload string as the final part of the message.
-        self.dim_pub_socket.send_string(payload)
+        if header is None:
+            # Step 2: Send the payload string as the final part of the message.
+            self.dim_pub_socket.send_string(payload)
+        else:
+            if 'trace' in header:
+                header['trace']['publish'] = monotonic_ns()
+            self.dim_pub_socket.send_string(payload, zmq.SNDMORE)
+            self.dim_pub_socket.send_json(header)
         
         logging.info(f"Published to DIM on topic '{topic}'")
 
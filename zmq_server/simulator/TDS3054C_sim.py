@@ -0,0 +1,389 @@
+import html
+import logging
+import random
+import re
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from urllib.parse import parse_qs
+
+import numpy as np
+
+
+class SimulatorConfig:
+    """
+    Timing and signal knobs of the simulator. The defaults are roughly what the real
+    TDS3054C web interface does: a few tens of ms per HTTP request and ~1 Mbit/s of payload.
+    """
+    def __init__(self, latency_ms: float = 30.0, throughput_kbps: float = 1000.0,
+                 trigger_rate_hz: float = 50.0, record_length: int = 10000, seed: int = 1234):
+        self.latency_ms = latency_ms                # Fixed cost of every request (connect + parse)
+        self.throughput_kbps = throughput_kbps      # Response payload rate, 0 disables throttling
+        self.trigger_rate_hz = trigger_rate_hz      # Mean rate of the (Poisson) trigger source
+        self.record_length = record_length          # Points per channel record
+        self.seed = seed                            # Makes waveforms and trigger times reproducible
+
+
+class ScpiHeader:
+    """
+    A SCPI command header such as 'CH<n>:SCAle'. Matches both the short form (upper case part)
+    and the long form of each mnemonic, case-insensitively, with an optional leading ':'.
+    """
+    def __init__(self, pattern: str):
+        self.pattern = pattern
+        is_query = pattern.endswith('?')
+        parts = []
+        for mnemonic in pattern.rstrip('?').split(':'):
+            suffix = ''
+            if mnemonic.endswith('<n>'):
+                mnemonic = mnemonic[:-3]
+                suffix = r'([1-4])'
+            short_len = len(mnemonic) - len(mnemonic.lstrip('*ABCDEFGHIJKLMNOPQRSTUVWXYZ'))
+            short, rest = mnemonic[:short_len], mnemonic[short_len:]
+            optional = ''.join(f'(?:{re.escape(c.upper())}' for c in rest) + ')?' * len(rest)
+            parts.append(re.escape(short) + optional + suffix)
+        self.regex = re.compile(r':?' + ':'.join(parts) + (r'\?' if is_query else '') + r'$', re.IGNORECASE)
+
+    def match(self, header: str):
+        return self.regex.match(header)
+
+
+class TDS3054CSimulator:
+    """
+    Instrument model behind the simulated Comm.html form. Holds the settings the TDS3054C driver
+    touches, an acquisition state machine driven by a Poisson trigger and the last acquired record.
+    """
+    IDN = "TEKTRONIX,TDS 3054C,0,CF:91.1CT FV:v4.05 TDS3FFT:v1.00"
+    CHANNELS = 4
+    LEVELS_PER_DIV = {1: 25, 2: 6400}   # Digitizer levels per division for DATA:WID 1 / 2
+
+    def __init__(self, config: SimulatorConfig):
+        self.config = config
+        self.rng = random.Random(config.seed)
+        self.np_rng = np.random.default_rng(config.seed)
+        self.lock = threading.Lock()
+
+        # Settings
+        self.selected = [True, False, False, False]
+        self.scale = [0.1] * self.CHANNELS
+        self.position = [0.0] * self.CHANNELS
+        self.horizontal_scale = 4.0e-5
+        self.horizontal_position = 0.0
+        self.trigger_level = 0.0
+        self.trigger_slope = "RISE"
+        self.trigger_source = "CH1"
+        self.data_source = 1
+        self.encoding = "ASCII"
+        self.width = 1
+        self.data_start = 1
+        self.data_stop = config.record_length
+        self.acq_mode = "SAMPLE"
+        self.num_avg = 16
+        self.num_env = 16
+        self.stop_after = "RUNSTOP"
+        self.saved_setups = {}      # *SAV slot -> settings
+
+        # Acquisition state
+        self.armed = False
+        self.trigger_time = None
+        self.records = [np.zeros(config.record_length) for _ in range(self.CHANNELS)]
+        # AVERAGE/ENVELOPE accumulate over several triggers: count, running sum, running min/max
+        self.acquired = 0
+        self.avg_sum = None
+        self.env_min = None
+        self.env_max = None
+
+        self.handlers = [
+            (ScpiHeader('*IDN?'), lambda m, arg: self.IDN),
+            (ScpiHeader('BUSY?'), self._busy),
+            (ScpiHeader('SELect?'), self._select_query),
+            (ScpiHeader('SELect:CH<n>'), self._select_channel),
+            (ScpiHeader('CH<n>:SCAle'), self._set_channel_value(self.scale)),
+            (ScpiHeader('CH<n>:SCAle?'), self._get_channel_value(self.scale)),
+            (ScpiHeader('CH<n>:POSition'), self._set_channel_value(self.position)),
+            (ScpiHeader('CH<n>:POSition?'), self._get_channel_value(self.position)),
+            (ScpiHeader('HORizontal:MAIn:SCAle'), self._set_attr('horizontal_scale', float)),
+            (ScpiHeader('HORizontal:MAIn:SCAle?'), self._get_attr('horizontal_scale')),
+            (ScpiHeader('HORizontal:MAIn:POSition'), self._set_attr('horizontal_position', float)),
+            (ScpiHeader('HORizontal:MAIn:POSition?'), self._get_attr('horizontal_position')),
+            (ScpiHeader('TRIGger:A:LEVel'), self._set_attr('trigger_level', float)),
+            (ScpiHeader('TRIGger:A:LEVel?'), self._get_attr('trigger_level')),
+            (ScpiHeader('TRIGger:A:EDGE:SLOpe'), self._set_attr('trigger_slope', str.upper)),
+            (ScpiHeader('TRIGger:A:EDGE:SLOpe?'), self._get_attr('trigger_slope')),
+            (ScpiHeader('TRIGger:A:EDGE:SOUrce'), self._set_attr('trigger_source', str.upper)),
+            (ScpiHeader('TRIGger:A:EDGE:SOUrce?'), self._get_attr('trigger_source')),
+            (ScpiHeader('DATa:SOUrce'), self._set_data_source),
+            (ScpiHeader('DATa:ENCdg'), self._set_attr('encoding', str.upper)),
+            (ScpiHeader('DATa:WIDth'), self._set_width),
+            (ScpiHeader('DATa:STARt'), self._set_attr('data_start', int)),
+            (ScpiHeader('DATa:STOP'), self._set_attr('data_stop', int)),
+            (ScpiHeader('WFMPre:XINcr?'), lambda m, arg: f"{self._x_increment():.4E}"),
+            (ScpiHeader('WFMPre:YMUlt?'), lambda m, arg: f"{self._y_mult(self.data_source):.4E}"),
+            (ScpiHeader('WFMPre:YZEro?'), lambda m, arg: "0.0E+0"),
+            (ScpiHeader('WFMPre:YOFf?'), lambda m, arg: f"{self._y_off(self.data_source):.4E}"),
+            (ScpiHeader('CURVe?'), self._curve),
+            (ScpiHeader('ACQuire:STATE'), self._set_acq_state),
+            (ScpiHeader('ACQuire:STATE?'), lambda m, arg: "1" if self.armed else "0"),
+            (ScpiHeader('ACQuire:STOPAfter'), self._set_attr('stop_after', str.upper)),
+            (ScpiHeader('ACQuire:MODe'), self._set_attr('acq_mode', str.upper)),
+            (ScpiHeader('ACQuire:MODe?'), self._get_attr('acq_mode')),
+            (ScpiHeader('ACQuire:NUMAVg'), self._set_attr('num_avg', int)),
+            (ScpiHeader('ACQuire:NUMAVg?'), self._get_attr('num_avg')),
+            (ScpiHeader('ACQuire:NUMEnv'), self._set_attr('num_env', int)),
+            (ScpiHeader('ACQuire:NUMEnv?'), self._get_attr('num_env')),
+            (ScpiHeader('*SAV'), self._save_setup),
+            (ScpiHeader('*RCL'), self._recall_setup),
+            (ScpiHeader('*OPC?'), lambda m, arg: "1"),
+        ]
+
+    # --- SCPI entry point ---
+
+    def execute(self, message: str):
+        """
+        Executes a message of one or more ';' separated commands. Returns the joined query
+        responses as bytes (CURVE? in RIB encoding is binary), or b'' for pure writes.
+        """
+        responses = []
+        with self.lock:
+            self._update_acquisition()
+            for command in filter(None, (c.strip() for c in message.split(';'))):
+                header, _, argument = command.partition(' ')
+                response = self._dispatch(header, argument.strip())
+                if response is not None:
+                    responses.append(response if isinstance(response, bytes) else response.encode('latin-1'))
+        return b';'.join(responses)
+
+    def _dispatch(self, header: str, argument: str):
+        for scpi_header, handler in self.handlers:
+            match = scpi_header.match(header)
+            if match:
+                return handler(match, argument)
+        logging.warning(f"[Simulator] Unsupported command header '{header}'")
+        return None
+
+    # --- Acquisition model ---
+
+    def _record_time(self) -> float:
+        return 10.0 * self.horizontal_scale
+
+    def _arm(self):
+        """Starts an acquisition: the next trigger arrives after an exponential wait plus one record."""
+        self.armed = True
+        wait = self.rng.expovariate(self.config.trigger_rate_hz) if self.config.trigger_rate_hz > 0 else float('inf')
+        self.trigger_time = time.monotonic() + wait + self._record_time()
+
+    def _update_acquisition(self):
+        if not self.armed or time.monotonic() < self.trigger_time:
+            return
+        self._acquire_records()
+        # In single sequence, AVERAGE and ENVELOPE stop after NUMAVG/NUMENV triggers, not after one.
+        needed = 1
+        if self.acq_mode.startswith("AVE"):
+            needed = self.num_avg
+        elif self.acq_mode.startswith("ENV"):
+            needed = self.num_env
+        if (self.stop_after == "SEQUENCE" or self.stop_after == "SEQ") and self.acquired >= needed:
+            self.armed = False
+        else:
+            self._arm()
+
+    def _acquire_records(self):
+        """Synthesises one shot per channel and folds it into the records according to ACQ:MODE."""
+        shots = self._synthesise_shots()
+        self.acquired += 1
+        if self.acq_mode.startswith("AVE"):
+            self.avg_sum = shots if self.avg_sum is None else [s + x for s, x in zip(self.avg_sum, shots)]
+            self.records = [s / self.acquired for s in self.avg_sum]
+        elif self.acq_mode.startswith("ENV"):
+            self.env_min = shots if self.env_min is None else [np.minimum(m, x) for m, x in zip(self.env_min, shots)]
+            self.env_max = shots if self.env_max is None else [np.maximum(m, x) for m, x in zip(self.env_max, shots)]
+            self.records = [np.stack([lo, hi]) for lo, hi in zip(self.env_min, self.env_max)]
+        else:
+            self.records = shots
+
+    def _synthesise_shots(self) -> list:
+        """One record per channel: PMT-like pulses on odd channels, a sine on even ones."""
+        n = self.config.record_length
+        t = np.arange(n)
+        shots = []
+        for ch in range(self.CHANNELS):
+            wave = self.np_rng.normal(0.0, 0.02 * self.scale[ch], n)
+            if ch % 2 == 0:
+                amplitude = self.np_rng.exponential(2.0 * self.scale[ch])
+                start = n // 10
+                tail = t[start:] - start
+                wave[start:] -= amplitude * (np.exp(-tail / (n / 1000.0 + 4.0)) - np.exp(-tail / (n / 5000.0 + 1.0)))
+            else:
+                wave += 2.0 * self.scale[ch] * np.sin(2.0 * np.pi * 5.0 * t / n + self.np_rng.uniform(0, 2 * np.pi))
+            shots.append(wave)
+        return shots
+
+    # --- Handlers ---
+
+    def _busy(self, match, arg):
+        return "1" if self.armed else "0"
+
+    def _select_query(self, match, arg):
+        channels = ";".join("1" if s else "0" for s in self.selected)
+        return f"{channels};0;0;0;0;0;CONTROL CH1"
+
+    def _select_channel(self, match, arg):
+        self.selected[int(match.group(1)) - 1] = arg.upper() in ("ON", "1")
+
+    def _set_channel_value(self, target: list):
+        def handler(match, arg):
+            target[int(match.group(1)) - 1] = float(arg)
+        return handler
+
+    def _get_channel_value(self, target: list):
+        return lambda match, arg: f"{target[int(match.group(1)) - 1]:.4E}"
+
+    def _set_attr(self, name: str, convert):
+        def handler(match, arg):
+            setattr(self, name, convert(arg))
+        return handler
+
+    def _get_attr(self, name: str):
+        def handler(match, arg):
+            value = getattr(self, name)
+            return f"{value:.4E}" if isinstance(value, float) else str(value)
+        return handler
+
+    def _set_data_source(self, match, arg):
+        found = re.match(r'CH([1-4])$', arg.upper())
+        if found:
+            self.data_source = int(found.group(1))
+
+    def _set_width(self, match, arg):
+        self.width = 2 if arg.strip() == "2" else 1
+
+    def _set_acq_state(self, match, arg):
+        if arg.upper() in ("ON", "RUN", "1"):
+            self.acquired = 0
+            self.avg_sum = self.env_min = self.env_max = None
+            self._arm()
+        else:
+            self.armed = False
+
+    # Front-panel settings covered by *SAV/*RCL
+    SETUP_FIELDS = ("selected", "scale", "position", "horizontal_scale", "horizontal_position", "trigger_level",
+                    "trigger_slope", "trigger_source", "acq_mode", "num_avg", "num_env")
+
+    def _save_setup(self, match, arg):
+        self.saved_setups[int(arg)] = {name: self._copy(getattr(self, name)) for name in self.SETUP_FIELDS}
+
+    def _recall_setup(self, match, arg):
+        setup = self.saved_setups.get(int(arg))
+        if setup is None:
+            logging.warning(f"[Simulator] *RCL of empty setup slot {arg}")
+            return
+        for name, value in setup.items():
+            if isinstance(value, list):
+                getattr(self, name)[:] = value      # The CH<n> handlers hold on to these lists
+            else:
+                setattr(self, name, value)
+        self.armed = False
+
+    @staticmethod
+    def _copy(value):
+        return list(value) if isinstance(value, list) else value
+
+    def _x_increment(self) -> float:
+        return self._record_time() / self.config.record_length
+
+    def _y_mult(self, channel: int) -> float:
+        return self.scale[channel - 1] / self.LEVELS_PER_DIV[self.width]
+
+    def _y_off(self, channel: int) -> float:
+        return 0.0 - self.position[channel - 1] * self.LEVELS_PER_DIV[self.width]
+
+    def _curve(self, match, arg):
+        """Returns the DATA:START..STOP part of the last record as ASCII levels or a RIB block."""
+        ch = self.data_source
+        start = max(1, self.data_start)
+        stop = min(self.config.record_length, max(start, self.data_stop))
+        record = self.records[ch - 1]
+        if record.ndim == 2:
+            # Envelope: a min/max pair per point, min first
+            volts = np.empty(2 * (stop - start + 1))
+            volts[0::2] = record[0][start - 1:stop]
+            volts[1::2] = record[1][start - 1:stop]
+        else:
+            volts = record[start - 1:stop]
+
+        limit = 127 if self.width == 1 else 32767
+        codes = np.clip(np.round(volts / self._y_mult(ch) + self._y_off(ch)), -limit - 1, limit).astype(np.int64)
+
+        if self.encoding == "ASCII" or self.encoding == "ASCI":
+            return ",".join(map(str, codes.tolist()))
+
+        # RIB: signed, MSB first, as an IEEE 488.2 definite length block.
+        data = codes.astype('>i2' if self.width == 2 else 'i1').tobytes()
+        length = str(len(data))
+        return f"#{len(length)}{length}".encode('latin-1') + data
+
+
+class CommPageHandler(BaseHTTPRequestHandler):
+    """
+    Emulates /Comm.html: a form POST with COMMAND=<scpi>&gpibsend=Send, answered with the full page
+    and the instrument response inside <textarea name="name">. Every response closes the connection,
+    as on the real instrument.
+    """
+    protocol_version = "HTTP/1.0"
+    PAGE = ("<HTML><HEAD><TITLE>Tektronix TDS 3054C - Communication</TITLE></HEAD><BODY>"
+            "<FORM ACTION=\"Comm.html\" METHOD=\"POST\">"
+            "<INPUT TYPE=\"text\" NAME=\"COMMAND\" SIZE=\"60\">"
+            "<INPUT TYPE=\"submit\" NAME=\"gpibsend\" VALUE=\"Send\">"
+            "<TEXTAREA NAME=\"name\" ROWS=\"10\" COLS=\"60\">{response}</TEXTAREA>"
+            "</FORM></BODY></HTML>")
+
+    # Set by serve()
+    instrument = None
+    config = None
+
+    def do_GET(self):
+        if self.path.split('?')[0] != "/Comm.html":
+            self.send_error(404)
+            return
+        self._respond(b"")
+
+    def do_POST(self):
+        if self.path.split('?')[0] != "/Comm.html":
+            self.send_error(404)
+            return
+        length = int(self.headers.get('Content-Length', 0))
+        form = parse_qs(self.rfile.read(length).decode('utf-8', errors='replace'))
+        command = form.get('COMMAND', [''])[0]
+        self._respond(self.instrument.execute(command))
+
+    def _respond(self, response: bytes):
+        time.sleep(self.config.latency_ms / 1000.0)
+
+        text = html.escape(response.decode('latin-1'), quote=False)
+        body = self.PAGE.format(response=text).encode('latin-1')
+        if self.config.throughput_kbps > 0:
+            time.sleep(len(body) * 8 / (self.config.throughput_kbps * 1000.0))
+
+        self.send_response(200)
+        self.send_header("Content-Type", "text/html")
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("Connection", "close")
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        logging.debug(f"[Simulator] {self.address_string()} {format % args}")
+
+
+def serve(host: str, port: int, config: SimulatorConfig):
+    """Runs the simulator until interrupted. The real web server is single-threaded, so is this one."""
+    CommPageHandler.instrument = TDS3054CSimulator(config)
+    CommPageHandler.config = config
+    server = HTTPServer((host, port), CommPageHandler)
+    logging.info(f"TDS3054C simulator listening on http://{host}:{port}/Comm.html")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        logging.info("Simulator shutting down.")
+    finally:
+        server.server_close()